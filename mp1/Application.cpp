@@ -47,11 +47,21 @@ int main(int argc, char *argv[]) {
 Application::Application(char *infile) {
 	int i;
 	par = new Params();
-	srand (time(NULL));
 	par->setparams(infile);
+	rng.seed(par->SEED, RNG_STREAM_APP);
+	printf("SEED: %lu\n", par->SEED);
 	log = new Log(par);
-	en = new EmulNet(par);
+	if ( par->TRANSPORT == UDP_TRANSPORT ) {
+		en = new UdpNet(par);
+	}
+	else if ( par->TRANSPORT == URING_TRANSPORT ) {
+		en = new UringNet(par);
+	}
+	else {
+		en = new EmulNet(par);
+	}
 	mp1 = (MP1Node **) malloc(par->EN_GPSZ * sizeof(MP1Node *));
+	workers = (par->THREADS > 1) ? new WorkerPool(par->THREADS) : NULL;
 
 	/*
 	 * Init all nodes
@@ -73,6 +83,7 @@ Application::Application(char *infile) {
  * Destructor
  */
 Application::~Application() {
+	delete workers;
 	delete log;
 	delete en;
 	for ( int i = 0; i < par->EN_GPSZ; i++ ) {
@@ -93,7 +104,9 @@ int Application::run()
 	int timeWhenAllNodesHaveJoined = 0;
 	// boolean indicating if all nodes have joined
 	bool allNodesJoined = false;
-	srand(time(NULL));
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
 
 	// As time runs along
 	for( par->globaltime = 0; par->globaltime < TOTAL_RUNNING_TIME; ++par->globaltime ) {
@@ -101,15 +114,28 @@ int Application::run()
 		mp1Run();
 		// Fail some nodes
 		fail();
+		// Give nodes in other processes the chance to keep up
+		if ( par->TICK_USEC > 0 ) {
+			usleep(par->TICK_USEC);
+		}
 	}
 
-	// Clean up
-	en->ENcleanup();
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if( !par->EN_REPLAY.empty() ) {
+		printf("Replay of %s took %.3f ms\n", par->EN_REPLAY.c_str(),
+				(end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+	}
+
+	logJoinLatency();
 
+	// Clean up; nodes hand their buffers back before the network goes away
 	for(i=0;i<=par->EN_GPSZ-1;i++) {
 		 mp1[i]->finishUpThisNode();
 	}
 
+	en->ENcleanup();
+	Trace::dump(TRACE_LOG);
+
 	return SUCCESS;
 }
 
@@ -121,13 +147,18 @@ int Application::run()
 void Application::mp1Run() {
 	int i;
 
+	if( workers ) {
+		mp1RunParallel();
+		return;
+	}
+
 	// For all the nodes in the system
 	for( i = 0; i <= par->EN_GPSZ-1; i++) {
 
 		/*
 		 * Receive messages from the network and queue them in the membership protocol queue
 		 */
-		if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
+		if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) && par->isLocal(i+1) ) {
 			// Receive messages from the network and queue them
 			mp1[i]->recvLoop();
 		}
@@ -137,6 +168,11 @@ void Application::mp1Run() {
 	// For all the nodes in the system
 	for( i = par->EN_GPSZ - 1; i >= 0; i-- ) {
 
+		// Node run by another process
+		if( !par->isLocal(i+1) ) {
+			continue;
+		}
+
 		/*
 		 * Introduce nodes into the distributed system
 		 */
@@ -151,8 +187,13 @@ void Application::mp1Run() {
 		 * Handle all the messages in your queue and send heartbeats
 		 */
 		else if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
-			// handle messages and send heartbeats
-			mp1[i]->nodeLoop();
+			// handle messages and send heartbeats; a replay only runs the handlers
+			if( par->EN_REPLAY.empty() ) {
+				mp1[i]->nodeLoop();
+			}
+			else {
+				mp1[i]->checkMessages();
+			}
 			#ifdef DEBUGLOG
 			if( (i == 0) && (par->globaltime % 500 == 0) ) {
 				log->LOG(&mp1[i]->getMemberNode()->addr, "@@time=%d", par->getcurrtime());
@@ -160,7 +201,120 @@ void Application::mp1Run() {
 			#endif
 		}
 
+		// Send what the node produced this tick
+		en->ENcommit(&mp1[i]->getMemberNode()->addr);
+
+	}
+}
+
+/**
+ * FUNCTION NAME: mp1RunParallel
+ *
+ * DESCRIPTION:	Same tick as mp1Run, with the nodes spread over the worker threads. Every node
+ * 				only touches its own state while the phases run; the messages and log lines it
+ * 				produces are staged and committed afterwards in the order mp1Run would have
+ * 				produced them, so a run gives the same result whatever the thread count.
+ *
+ * 				The network routes the staged messages a destination shard per worker, each
+ * 				in mp1Run's sender order; what is left, the log lines and the accounting, is
+ * 				committed node by node on this thread.
+ */
+void Application::mp1RunParallel() {
+	int i;
+	int time = par->getcurrtime();
+
+	// Receive phase
+	en->ENdeliver();
+	workers->run(par->EN_GPSZ, [this, time](int i, int worker) {
+		en->ENbind(worker);
+		if( time > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) && par->isLocal(i+1) ) {
+			mp1[i]->recvLoop();
+		}
+	});
+
+	// Process phase
+	en->ENstage(true);
+	log->stage(true);
+	workers->run(par->EN_GPSZ, [this, time](int i, int worker) {
+		en->ENbind(worker);
+		if( !par->isLocal(i+1) ) {
+			return;
+		}
+		if( time == (int)(par->STEP_RATE*i) ) {
+			mp1[i]->nodeStart(JOINADDR, par->PORTNUM);
+		}
+		else if( time > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
+			if( par->EN_REPLAY.empty() ) {
+				mp1[i]->nodeLoop();
+			}
+			else {
+				mp1[i]->checkMessages();
+			}
+		}
+	});
+	en->ENstage(false);
+	log->stage(false);
+
+	// Route phase
+	int shards = en->ENshards();
+	if( shards > 0 ) {
+		workers->run(shards, [this](int shard, int worker) {
+			en->ENbind(worker);
+			en->ENcommitShard(shard);
+		});
+	}
+	en->ENbind(0);
+
+	// Commit, node by node in mp1Run's order
+	for( i = par->EN_GPSZ - 1; i >= 0; i-- ) {
+		if( !par->isLocal(i+1) ) {
+			continue;
+		}
+		Address *addr = &mp1[i]->getMemberNode()->addr;
+		log->commit(addr);
+		en->ENcommit(addr);
+
+		if( time == (int)(par->STEP_RATE*i) ) {
+			cout<<i<<"-th introduced node is assigned with the address: "<<mp1[i]->getMemberNode()->addr.getAddress() << endl;
+			nodeCount += i;
+		}
+		#ifdef DEBUGLOG
+		else if( (i == 0) && (par->globaltime % 500 == 0) && time > 0 && !(mp1[i]->getMemberNode()->bFailed) ) {
+			log->LOG(&mp1[i]->getMemberNode()->addr, "@@time=%d", par->getcurrtime());
+		}
+		#endif
+	}
+}
+
+/**
+ * FUNCTION NAME: logJoinLatency
+ *
+ * DESCRIPTION: Summarize in stats.log how many ticks this process's nodes took from
+ * 				nodeStart to getting into the group
+ */
+void Application::logJoinLatency() {
+	int joined = 0, local = 0, worst = 0;
+	long total = 0;
+
+	for ( int i = 0; i < par->EN_GPSZ; i++ ) {
+		if ( !par->isLocal(i + 1) ) {
+			continue;
+		}
+		local++;
+		int ticks = mp1[i]->getMemberNode()->joinTicks;
+		if ( ticks >= 0 ) {
+			joined++;
+			total += ticks;
+			worst = max(worst, ticks);
+		}
+	}
+
+	#ifdef DEBUGLOG
+	if ( local > 0 ) {
+		log->LOG(&mp1[0]->getMemberNode()->addr, "#STATSLOG# join latency: %d of %d nodes joined, mean %.2f max %d ticks",
+				joined, local, joined ? (double)total / joined : 0.0, worst);
 	}
+	#endif
 }
 
 /**
@@ -179,14 +333,14 @@ void Application::fail() {
 	}
 
 	if( par->SINGLE_FAILURE && par->getcurrtime() == 100 ) {
-		removed = (rand() % par->EN_GPSZ);
+		removed = rng.below(par->EN_GPSZ);
 		#ifdef DEBUGLOG
 		log->LOG(&mp1[removed]->getMemberNode()->addr, "Node failed at time=%d", par->getcurrtime());
 		#endif
 		mp1[removed]->getMemberNode()->bFailed = true;
 	}
 	else if( par->getcurrtime() == 100 ) {
-		removed = rand() % par->EN_GPSZ/2;
+		removed = rng.below(par->EN_GPSZ) / 2;
 		for ( i = removed; i < removed + par->EN_GPSZ/2; i++ ) {
 			#ifdef DEBUGLOG
 			log->LOG(&mp1[i]->getMemberNode()->addr, "Node failed at time = %d", par->getcurrtime());
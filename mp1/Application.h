@@ -13,7 +13,10 @@
 #include "Params.h"
 #include "Member.h"
 #include "EmulNet.h"
+#include "UdpNet.h"
+#include "UringNet.h"
 #include "Queue.h"
+#include "WorkerPool.h"
 
 /**
  * global variables
@@ -36,17 +39,23 @@ private:
 	// Address for introduction to the group
 	// Coordinator Node
 	char JOINADDR[30];
-	EmulNet *en;
+	Transport *en;
     Log *log;
 	MP1Node **mp1;
 	Params *par;
+	// failure injection
+	Random rng;
+	// Runs the nodes when THREADS > 1
+	WorkerPool *workers;
 public:
 	Application(char *);
 	virtual ~Application();
 	Address getjoinaddr();
 	int run();
 	void mp1Run();
+	void mp1RunParallel();
 	void fail();
+	void logJoinLatency();
 };
 
 #endif /* _APPLICATION_H__ */
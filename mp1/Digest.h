@@ -0,0 +1,65 @@
+/**********************************
+ * FILE NAME: Digest.h
+ *
+ * DESCRIPTION: Bucketed hash of who is in a membership table and at which heartbeat, for anti-entropy
+ **********************************/
+
+#ifndef DIGEST_H_
+#define DIGEST_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// buckets the members are hashed into; one bit each in a DIGEST_SYNC mask, so at most 64
+#define DIGEST_BUCKETS 64
+
+/**
+ * CLASS NAME: MembershipDigest
+ *
+ * DESCRIPTION: The members of a table hashed with their heartbeats into DIGEST_BUCKETS
+ * 				buckets, each the XOR of its members' hashes, so adding or removing a member
+ * 				is one XOR. A member goes in the same bucket whatever its heartbeat. The root
+ * 				is the XOR of the buckets. Two tables with the same members at the same
+ * 				heartbeats have the same digest; where they differ, only the buckets that
+ * 				differ need be compared. That needs heartbeats that settle: with one every
+ * 				tick no two tables would ever agree, so DIGEST beats every HEARTBEAT_EPOCH.
+ */
+class MembershipDigest {
+private:
+	uint64_t buckets[DIGEST_BUCKETS];
+	uint64_t top;
+	// splitmix64 finalizer
+	static uint64_t mix(uint64_t v) {
+		v += 0x9E3779B97F4A7C15ULL;
+		v = (v ^ (v >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		v = (v ^ (v >> 27)) * 0x94D049BB133111EBULL;
+		return v ^ (v >> 31);
+	}
+public:
+	MembershipDigest() {
+		clear();
+	}
+	static int bucketOf(uint64_t member) {
+		return (int)(mix(member) % DIGEST_BUCKETS);
+	}
+	// Add the member at this heartbeat if it is not counted, remove it if it is
+	void toggle(uint64_t member, long heartbeat) {
+		uint64_t h = mix(member ^ mix((uint64_t)heartbeat));
+		buckets[bucketOf(member)] ^= h;
+		top ^= h;
+	}
+	void clear() {
+		memset(buckets, 0, sizeof(buckets));
+		top = 0;
+	}
+	uint64_t root() const {
+		return top;
+	}
+	uint64_t bucket(int i) const {
+		return buckets[i];
+	}
+};
+
+#endif /* DIGEST_H_ */
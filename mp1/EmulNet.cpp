@@ -6,22 +6,36 @@
 
 #include "EmulNet.h"
 
+// Message pool used by the calling thread, see ENbind
+static thread_local int enShard = 0;
+
 /**
  * Constructor
  */
 EmulNet::EmulNet(Params *p)
 {
 	//trace.funcEntry("EmulNet::EmulNet");
-	int i,j;
 	par = p;
 	emulnet.setNextId(1);
 	emulnet.settCurrBuffSize(0);
 	enInited=0;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			sent_msgs[i][j] = 0;
-			recv_msgs[i][j] = 0;
+	staging = false;
+	initPools();
+	shards.resize(par->EN_BUFFSIZE > 0 ? 1 : par->THREADS);
+	poolGrowthTick = 0;
+	lastHeapAllocs = 0;
+	peakBuffSize = 0;
+	replaying = false;
+	if ( !par->EN_REPLAY.empty() ) {
+		if ( !trace.openReplay(par->EN_REPLAY.c_str()) ) {
+			printf("Cannot replay trace %s\n", par->EN_REPLAY.c_str());
+			exit(1);
 		}
+		replaying = true;
+	}
+	else if ( !par->EN_TRACE.empty() && !trace.openCapture(par->EN_TRACE.c_str()) ) {
+		printf("Cannot write trace %s\n", par->EN_TRACE.c_str());
+		exit(1);
 	}
 	//trace.funcExit("EmulNet::EmulNet", SUCCESS);
 }
@@ -30,39 +44,120 @@ EmulNet::EmulNet(Params *p)
  * Copy constructor
  */
 EmulNet::EmulNet(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
+	initPools();
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->staging = anotherEmulNet.staging;
+	this->outbox = anotherEmulNet.outbox;
+	this->poolGrowthTick = anotherEmulNet.poolGrowthTick;
+	this->lastHeapAllocs = anotherEmulNet.lastHeapAllocs;
+	this->peakBuffSize = anotherEmulNet.peakBuffSize;
+	this->rngs = anotherEmulNet.rngs;
+	this->replaying = false;
+	this->msgcount = anotherEmulNet.msgcount;
 	this->emulnet = anotherEmulNet.emulnet;
+	this->shards = anotherEmulNet.shards;
 }
 
 /**
  * Assignment operator overloading
  */
 EmulNet& EmulNet::operator =(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->staging = anotherEmulNet.staging;
+	this->outbox = anotherEmulNet.outbox;
+	this->poolGrowthTick = anotherEmulNet.poolGrowthTick;
+	this->lastHeapAllocs = anotherEmulNet.lastHeapAllocs;
+	this->peakBuffSize = anotherEmulNet.peakBuffSize;
+	this->rngs = anotherEmulNet.rngs;
+	this->replaying = false;
+	this->msgcount = anotherEmulNet.msgcount;
 	this->emulnet = anotherEmulNet.emulnet;
+	this->shards = anotherEmulNet.shards;
 	return *this;
 }
 
 /**
  * Destructor
  */
-EmulNet::~EmulNet() {}
+EmulNet::~EmulNet() {
+	for ( size_t i = 0; i < pools.size(); i++ ) {
+		delete pools[i];
+	}
+}
+
+/**
+ * FUNCTION NAME: initPools
+ *
+ * DESCRIPTION: Create one message pool per worker thread
+ */
+void EmulNet::initPools() {
+	for ( int i = 0; i < par->THREADS; i++ ) {
+		pools.push_back(new MsgPool());
+	}
+}
+
+/**
+ * FUNCTION NAME: poolHeapAllocs
+ *
+ * DESCRIPTION: Heap allocations made by all the message pools together
+ */
+long EmulNet::poolHeapAllocs() {
+	long allocs = 0;
+	for ( size_t i = 0; i < pools.size(); i++ ) {
+		allocs += pools[i]->getHeapAllocs();
+	}
+	return allocs;
+}
+
+/**
+ * FUNCTION NAME: getMsgCount
+ *
+ * DESCRIPTION: Accounting record of the given node, created on first use
+ */
+MsgCount& EmulNet::getMsgCount(int id) {
+	assert(id >= 0);
+	if ( id >= (int)msgcount.size() ) {
+		msgcount.resize(id + 1);
+	}
+	return msgcount[id];
+}
+
+/**
+ * FUNCTION NAME: linkDelay
+ *
+ * DESCRIPTION: Ticks a message from src to dst spends in flight: LINK_DELAY, plus a
+ * 				per-link share of LINK_SPREAD derived from the link itself, plus a per-message
+ * 				draw of up to LINK_JITTER
+ */
+int EmulNet::linkDelay(int src, int dst) {
+	int delay = par->LINK_DELAY;
+	if ( par->LINK_SPREAD > 0 ) {
+		unsigned int link = (unsigned int)src * 2654435761u ^ (unsigned int)dst * 40503u;
+		link ^= link >> 15;
+		delay += link % (par->LINK_SPREAD + 1);
+	}
+	if ( par->LINK_JITTER > 0 ) {
+		delay += rngs[dst].below(par->LINK_JITTER + 1);
+	}
+	return delay;
+}
+
+/**
+ * FUNCTION NAME: deliverDue
+ *
+ * DESCRIPTION: Move the delayed messages that have become receivable by tick time into
+ * 				their destination inboxes
+ */
+void EmulNet::deliverDue(int time) {
+	EM &em = emulnet;
+	for ( size_t i = 0; i < shards.size(); i++ ) {
+		shards[i].inflight.advance(time, [&em](const en_msg &msg) {
+			em.getInbox(NodeId(msg.to).getid()).push_back(msg);
+		});
+	}
+}
 
 /**
  * FUNCTION NAME: ENinit
@@ -71,8 +166,18 @@ EmulNet::~EmulNet() {}
  */
 void *EmulNet::ENinit(Address *myaddr, short port) {
 	// Initialize data structures for this member
-	*(int *)(myaddr->addr) = emulnet.nextid++;
-    *(short *)(&myaddr->addr[4]) = 0;
+	*myaddr = Address(NodeId(emulnet.nextid++, 0));
+	// Reserve this node's inbox, outbox, accounting and random stream up front, so that
+	// nodes and shards on different threads never resize them
+	int id = NodeId(*myaddr).getid();
+	emulnet.getInbox(id);
+	getMsgCount(id);
+	if ( id >= (int)outbox.size() ) {
+		outbox.resize(id + 1);
+		rngs.resize(id + 1);
+	}
+	outbox[id].resize(shards.size());
+	rngs[id].seed(par->SEED, RNG_STREAM_INBOX + id);
 	return myaddr;
 }
 
@@ -85,38 +190,170 @@ void *EmulNet::ENinit(Address *myaddr, short port) {
  * size
  */
 int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
-	en_msg *em;
-	static char temp[2048];
-	int sendmsg = rand() % 100;
+	en_msg em;
+#ifdef DEBUGLOG
+	char temp[2048];
+#endif
+
+	// A replay delivers recorded traffic only
+	if( replaying ) {
+		return size;
+	}
 
-	if( (emulnet.currbuffsize >= ENBUFFSIZE) || (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100)) ) {
-		return 0;
+	// The only copy a message goes through: from here on the pooled buffer is handed
+	// over by pointer until the receiver releases it
+	em.size = size;
+	em.sent = par->getcurrtime();
+	em.from = *myaddr;
+	em.to = *toaddr;
+	em.data = pools[enShard]->acquire(size);
+	memcpy(em.data, data, size);
+
+	#ifdef DEBUGLOG
+		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)data, toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], NodeId(*toaddr).getport());
+	#endif
+
+	return send(em);
+}
+
+/**
+ * FUNCTION NAME: ENsendShared
+ *
+ * DESCRIPTION: Send a buffer from ENalloc without copying it. The message holds its own
+ * 				reference, which the receiver gives back; the caller keeps its own.
+ *
+ * RETURNS:
+ * size
+ */
+int EmulNet::ENsendShared(Address *myaddr, Address *toaddr, char *data, int size) {
+	en_msg em;
+
+	if( replaying ) {
+		return size;
 	}
 
-	em = (en_msg *)malloc(sizeof(en_msg) + size);
-	em->size = size;
+	em.size = size;
+	em.sent = par->getcurrtime();
+	em.from = *myaddr;
+	em.to = *toaddr;
+	em.data = data;
+	MsgPool::retain(data);
 
-	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
-	memcpy(&(em->to.addr), &(toaddr->addr), sizeof(em->from.addr));
-	memcpy(em + 1, data, size);
+	return send(em);
+}
 
-	emulnet.buff[emulnet.currbuffsize++] = em;
+/**
+ * FUNCTION NAME: ENalloc
+ *
+ * DESCRIPTION: A pooled buffer for ENsendShared, released with ENrelease
+ */
+char *EmulNet::ENalloc(int size) {
+	return pools[enShard]->acquire(size);
+}
 
-	int src = *(int *)(myaddr->addr);
-	int time = par->getcurrtime();
+/**
+ * FUNCTION NAME: send
+ *
+ * DESCRIPTION: Queue a message whose buffer it owns until it is committed, or route it
+ * 				right away
+ */
+int EmulNet::send(en_msg &em) {
+	int dst = NodeId(em.to).getid();
+	if( staging ) {
+		outbox[NodeId(em.from).getid()][dst % shards.size()].msgs.push_back(em);
+		return em.size;
+	}
+	int size = route(em);
+	if( size > 0 ) {
+		countRouted(NodeId(em.from).getid(), 1, size);
+	}
+	return size;
+}
 
-	assert(src <= MAX_NODES);
-	assert(time < MAX_TIME);
+/**
+ * FUNCTION NAME: route
+ *
+ * DESCRIPTION: Decide the fate of a message and, unless it is dropped, place it in its
+ * 				destination inbox or in its shard's in-flight wheel. Only the destination's
+ * 				inbox, random stream and shard are touched; the caller counts the message
+ * 				with countRouted.
+ *
+ * RETURNS:
+ * size, or 0 if the message was dropped
+ */
+int EmulNet::route(en_msg &em) {
+	int dst = NodeId(em.to).getid();
+	assert(dst >= 0 && dst < (int)rngs.size());
+	RouteShard &shard = shards[dst % shards.size()];
+	int sendmsg = rngs[dst].below(100);
+	int size = em.size;
+
+	if( size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE ) {
+		shard.oversizeDrops++;
+		trace.capture(par->getcurrtime(), em.sent, em.from, em.to, em.data, size, TRACE_DROPPED_OVERSIZE);
+		ENrelease(em.data);
+		return 0;
+	}
+	if( par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100) ) {
+		shard.probDrops++;
+		trace.capture(par->getcurrtime(), em.sent, em.from, em.to, em.data, size, TRACE_DROPPED_PROB);
+		ENrelease(em.data);
+		return 0;
+	}
 
-	sent_msgs[src][time]++;
+	RingBuffer<en_msg> &inbox = emulnet.getInbox(dst);
+
+	// The in-flight store grows on demand unless EN_BUFFSIZE bounds it. The bound counts
+	// every message in flight, but DROP_OLDEST_FOR_DEST only makes room in this message's
+	// own inbox; with nothing queued there, the message itself is dropped.
+	if( par->EN_BUFFSIZE > 0 && emulnet.currbuffsize >= par->EN_BUFFSIZE ) {
+		shard.capacityDrops++;
+		if( par->EN_OVERFLOW == DROP_NEWEST || inbox.empty() ) {
+			trace.capture(par->getcurrtime(), em.sent, em.from, em.to, em.data, size, TRACE_DROPPED_CAPACITY);
+			ENrelease(em.data);
+			return 0;
+		}
+		en_msg &oldest = inbox.front();
+		trace.capture(par->getcurrtime(), oldest.sent, oldest.from, oldest.to, oldest.data, oldest.size, TRACE_DROPPED_CAPACITY);
+		ENrelease(oldest.data);
+		inbox.pop_front();
+		emulnet.currbuffsize--;
+	}
 
-	#ifdef DEBUGLOG
-		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)data, toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
-	#endif
+	// Without delay a message is receivable from the next tick on; a delay of d holds
+	// it back another d ticks
+	int delay = linkDelay(NodeId(em.from).getid(), dst);
+	if( delay > 0 ) {
+		shard.inflight.schedule(par->getcurrtime() + delay, em);
+	}
+	else {
+		inbox.push_back(em);
+	}
 
 	return size;
 }
 
+/**
+ * FUNCTION NAME: countRouted
+ *
+ * DESCRIPTION: Account for messages from src that route has put in flight
+ */
+void EmulNet::countRouted(int src, int messages, long bytes) {
+	int time = par->getcurrtime();
+
+	int inFlight = (emulnet.currbuffsize += messages);
+	if( inFlight > peakBuffSize ) {
+		peakBuffSize = inFlight;
+	}
+
+	getMsgCount(src).countSent(time, par->MSGCOUNT_WINDOW, bytes, messages);
+	long heapAllocs = poolHeapAllocs();
+	if ( heapAllocs != lastHeapAllocs ) {
+		lastHeapAllocs = heapAllocs;
+		poolGrowthTick = time;
+	}
+}
+
 /**
  * FUNCTION NAME: ENsend
  *
@@ -126,93 +363,255 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
  * size
  */
 int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
-	char * str = (char *) malloc(data.length() * sizeof(char));
-	memcpy(str, data.c_str(), data.size());
-	int ret = this->ENsend(myaddr, toaddr, str, (data.length() * sizeof(char)));
-	free(str);
-	return ret;
+	return this->ENsend(myaddr, toaddr, (char *)data.data(), (data.length() * sizeof(char)));
 }
 
 /**
  * FUNCTION NAME: ENrecv
  *
- * DESCRIPTION: EmulNet receive function
+ * DESCRIPTION: EmulNet receive function. Drains only this node's inbox, in the order
+ * 				the messages were sent. Each buffer is passed to enq as is; the receiver
+ * 				owns it until it calls ENrelease.
  *
  * RETURN:
  * 0
  */
 int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue){
 	// times is always assumed to be 1
-	int i;
-	char* tmp;
-	int sz;
-	en_msg *emsg;
 
-	for( i = emulnet.currbuffsize - 1; i >= 0; i-- ) {
-		emsg = emulnet.buff[i];
+	int dst = NodeId(*myaddr).getid();
+	int time = par->getcurrtime();
+
+	MsgCount &count = getMsgCount(dst);
 
-		if ( 0 == strcmp(emsg->to.addr, myaddr->addr) ) {
-			sz = emsg->size;
-			tmp = (char *) malloc(sz * sizeof(char));
-			memcpy(tmp, (char *)(emsg+1), sz);
+	if( replaying ) {
+		long bytes = 0;
+		int n = trace.replay(dst, time, enq, queue, bytes);
+		for ( int i = 0; i < n; i++ ) {
+			count.countRecv(time, par->MSGCOUNT_WINDOW, 0);
+		}
+		count.recvBytes += bytes;
+		return 0;
+	}
 
-			emulnet.buff[i] = emulnet.buff[emulnet.currbuffsize-1];
-			emulnet.currbuffsize--;
+	deliverDue(time);
+	RingBuffer<en_msg> &inbox = emulnet.getInbox(dst);
+	int received = 0;
+	while ( !inbox.empty() ) {
+		en_msg &emsg = inbox.front();
+		trace.capture(time, emsg.sent, emsg.from, emsg.to, emsg.data, emsg.size, TRACE_DELIVERED);
+		(*enq)(queue, emsg.data, emsg.size);
+		count.countRecv(time, par->MSGCOUNT_WINDOW, emsg.size);
+		inbox.pop_front();
+		received++;
+	}
+	emulnet.currbuffsize -= received;
 
-			(*enq)(queue, (char *)tmp, sz);
+	return 0;
+}
 
-			free(emsg);
+/**
+ * FUNCTION NAME: ENrelease
+ *
+ * DESCRIPTION: Return a buffer handed out by ENrecv once the receiver is done with it
+ */
+void EmulNet::ENrelease(char *data) {
+	// replayed messages live in the trace mapping
+	if ( trace.owns(data) ) {
+		return;
+	}
+	pools[enShard]->release(data);
+}
 
-			int dst = *(int *)(myaddr->addr);
-			int time = par->getcurrtime();
+/**
+ * FUNCTION NAME: ENbind
+ *
+ * DESCRIPTION: Make the calling thread allocate from and release to message pool shard
+ */
+void EmulNet::ENbind(int shard) {
+	enShard = shard % (int)pools.size();
+}
 
-			assert(dst <= MAX_NODES);
-			assert(time < MAX_TIME);
+/**
+ * FUNCTION NAME: ENstage
+ *
+ * DESCRIPTION: While staging, ENsend only queues each message under its sender and the
+ * 				shard of its destination, so that nodes running on different threads never
+ * 				touch shared network state. Staged messages enter the network through
+ * 				ENcommitShard, or when their sender is passed to ENcommit.
+ */
+void EmulNet::ENstage(bool on) {
+	staging = on;
+}
 
-			recv_msgs[dst][time]++;
+/**
+ * FUNCTION NAME: ENcommit
+ *
+ * DESCRIPTION: Route the messages this node staged that no ENcommitShard has, in the
+ * 				order it sent them, and count what it got into the network
+ *
+ * RETURNS:
+ * number of messages routed
+ */
+int EmulNet::ENcommit(Address *myaddr) {
+	int src = NodeId(*myaddr).getid();
+	vector<en_staged> &staged = outbox[src];
+	int count = 0, routed = 0;
+	long bytes = 0;
+	for ( size_t s = 0; s < staged.size(); s++ ) {
+		vector<en_msg> &msgs = staged[s].msgs;
+		for ( size_t i = 0; i < msgs.size(); i++ ) {
+			int size = route(msgs[i]);
+			// EN_BUFFSIZE sees every message as soon as it is in flight
+			if ( size > 0 ) {
+				countRouted(src, 1, size);
+			}
 		}
+		count += (int)msgs.size();
+		msgs.clear();
+		routed += staged[s].routed;
+		bytes += staged[s].bytes;
+		staged[s].routed = 0;
+		staged[s].bytes = 0;
+	}
+	if ( routed > 0 ) {
+		countRouted(src, routed, bytes);
 	}
+	return count;
+}
 
-	return 0;
+/**
+ * FUNCTION NAME: ENshards
+ *
+ * DESCRIPTION: Destination shards ENcommitShard can route concurrently. EN_BUFFSIZE
+ * 				bounds the messages in flight across all destinations in routing order, so
+ * 				with it set ENcommit routes everything itself.
+ */
+int EmulNet::ENshards() {
+	return par->EN_BUFFSIZE > 0 ? 0 : (int)shards.size();
 }
 
 /**
- * FUNCTION NAME: ENcleanup
+ * FUNCTION NAME: ENcommitShard
  *
- * DESCRIPTION: Cleanup the EmulNet. Called exactly once at the end of the program.
+ * DESCRIPTION: Route the staged messages for one shard's destinations, sender by sender
+ * 				in mp1Run's order, so that every destination gets its messages in the order
+ * 				and with the fate they would have had without staging. ENcommit counts them
+ * 				for their senders afterwards.
  */
-int EmulNet::ENcleanup() {
-	emulnet.nextid=0;
-	int i, j;
-	int sent_total, recv_total;
+void EmulNet::ENcommitShard(int shard) {
+	for ( int src = (int)outbox.size() - 1; src >= 0; src-- ) {
+		if ( outbox[src].empty() ) {
+			continue;
+		}
+		en_staged &staged = outbox[src][shard];
+		for ( size_t i = 0; i < staged.msgs.size(); i++ ) {
+			int size = route(staged.msgs[i]);
+			if ( size > 0 ) {
+				staged.routed++;
+				staged.bytes += size;
+			}
+		}
+		staged.msgs.clear();
+	}
+}
 
-	FILE* file = fopen("msgcount.log", "w+");
+/**
+ * FUNCTION NAME: ENdeliver
+ *
+ * DESCRIPTION: Move the delayed messages due this tick into their inboxes. ENrecv does
+ * 				this by itself; call it first when several threads are about to receive.
+ */
+void EmulNet::ENdeliver() {
+	deliverDue(par->getcurrtime());
+}
 
-	while(emulnet.currbuffsize > 0) {
-		free(emulnet.buff[--emulnet.currbuffsize]);
-	}
+/**
+ * FUNCTION NAME: logAll
+ *
+ * DESCRIPTION: Write the per-node part of msgcount.log for nodes 1..EN_GPSZ
+ */
+void MsgCount::logAll(FILE *file, vector<MsgCount> &counts, Params *par) {
+	int i, j;
+	int first = par->getcurrtime() - par->MSGCOUNT_WINDOW;
+	long sentBytes = 0, recvBytes = 0;
 
 	for ( i = 1; i <= par->EN_GPSZ; i++ ) {
+		MsgCount &count = counts[i];
 		fprintf(file, "node %3d ", i);
-		sent_total = 0;
-		recv_total = 0;
 
-		for (j = 0; j < par->getcurrtime(); j++) {
+		// Per-tick detail only exists for the last MSGCOUNT_WINDOW ticks
+		for (j = (first > 0 ? first : 0); j < par->getcurrtime(); j++) {
 
-			sent_total += sent_msgs[i][j];
-			recv_total += recv_msgs[i][j];
 			if (i != 67) {
-				fprintf(file, " (%4d, %4d)", sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, " (%4d, %4d)", count.getSent(j), count.getRecv(j));
 				if (j % 10 == 9) {
 					fprintf(file, "\n         ");
 				}
 			}
 			else {
-				fprintf(file, "special %4d %4d %4d\n", j, sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, "special %4d %4d %4d\n", j, count.getSent(j), count.getRecv(j));
 			}
 		}
 		fprintf(file, "\n");
-		fprintf(file, "node %3d sent_total %6u  recv_total %6u\n\n", i, sent_total, recv_total);
+		fprintf(file, "node %3d sent_total %6ld  recv_total %6ld\n\n", i, count.sentTotal, count.recvTotal);
+		sentBytes += count.sentBytes;
+		recvBytes += count.recvBytes;
+	}
+	fprintf(file, "bytes sent %ld  received %ld\n", sentBytes, recvBytes);
+}
+
+/**
+ * FUNCTION NAME: ENcleanup
+ *
+ * DESCRIPTION: Cleanup the EmulNet. Called exactly once at the end of the program.
+ */
+int EmulNet::ENcleanup() {
+	emulnet.nextid=0;
+	int i;
+
+	FILE* file = fopen("msgcount.log", "w+");
+
+	for ( i = 0; i < (int)emulnet.inbox.size(); i++ ) {
+		while ( !emulnet.inbox[i].empty() ) {
+			ENrelease(emulnet.inbox[i].front().data);
+			emulnet.inbox[i].pop_front();
+		}
+	}
+	long probDrops = 0, capacityDrops = 0, oversizeDrops = 0;
+	for ( i = 0; i < (int)shards.size(); i++ ) {
+		shards[i].inflight.drain([this](const en_msg &msg) {
+			ENrelease(msg.data);
+		});
+		probDrops += shards[i].probDrops;
+		capacityDrops += shards[i].capacityDrops;
+		oversizeDrops += shards[i].oversizeDrops;
+	}
+	emulnet.currbuffsize = 0;
+
+	// every node gets a line, including one that never sent or received
+	getMsgCount(par->EN_GPSZ);
+	MsgCount::logAll(file, msgcount, par);
+
+	fprintf(file, "dropped probabilistic %ld  capacity %ld  oversize %ld  peak_in_flight %d\n",
+			probDrops, capacityDrops, oversizeDrops, peakBuffSize);
+	long acquires = 0, releases = 0;
+	int inUse = 0, peakInUse = 0;
+	for ( i = 0; i < (int)pools.size(); i++ ) {
+		acquires += pools[i]->getAcquires();
+		releases += pools[i]->getReleases();
+		inUse += pools[i]->getInUse();
+		peakInUse += pools[i]->getPeakInUse();
+	}
+	fprintf(file, "msgpool heap_allocs %ld  last_heap_alloc_tick %d  acquires %ld  releases %ld  in_use %d  peak_in_use %d\n",
+			poolHeapAllocs(), poolGrowthTick, acquires, releases, inUse, peakInUse);
+
+	if ( replaying ) {
+		long replayed = 0;
+		for ( i = 0; i < (int)msgcount.size(); i++ ) {
+			replayed += msgcount[i].recvTotal;
+		}
+		fprintf(file, "replayed %ld of %ld delivered messages\n", replayed, trace.getDelivered());
 	}
 
 	fclose(file);
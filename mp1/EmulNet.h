@@ -7,13 +7,15 @@
 #ifndef _EMULNET_H_
 #define _EMULNET_H_
 
-#define MAX_NODES 1000
-#define MAX_TIME 3600
-#define ENBUFFSIZE 30000
-
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "MsgPool.h"
+#include "TimingWheel.h"
+#include "Transport.h"
+#include "Random.h"
+#include "PacketTrace.h"
+#include <atomic>
 
 using namespace std;
 
@@ -21,12 +23,16 @@ using namespace std;
  * Struct Name: en_msg
  */
 typedef struct en_msg {
-	// Number of bytes after the class
+	// Number of bytes in the payload
 	int size;
+	// Tick it was sent at
+	int sent;
 	// Source node
 	Address from;
 	// Destination node
 	Address to;
+	// Payload, owned by the EmulNet message pool until the receiver releases it
+	char *data;
 }en_msg;
 
 /**
@@ -35,19 +41,17 @@ typedef struct en_msg {
 class EM {
 public:
 	int nextid;
-	int currbuffsize;
+	// messages in flight; receivers on different threads take theirs off concurrently
+	atomic<int> currbuffsize;
 	int firsteltindex;
-	en_msg* buff[ENBUFFSIZE];
+	// Per-destination inboxes indexed by node id, each kept in FIFO order
+	vector< RingBuffer<en_msg> > inbox;
 	EM() {}
 	EM& operator = (EM &anotherEM) {
 		this->nextid = anotherEM.getNextId();
 		this->currbuffsize = anotherEM.getCurrBuffSize();
 		this->firsteltindex = anotherEM.getFirstEltIndex();
-		int i = this->currbuffsize;
-		while (i > 0) {
-			this->buff[i] = anotherEM.buff[i];
-			i--;
-		}
+		this->inbox = anotherEM.inbox;
 		return *this;
 	}
 	int getNextId() {
@@ -68,22 +72,145 @@ public:
 	void setFirstEltIndex(int firsteltindex) {
 		this->firsteltindex = firsteltindex;
 	}
+	RingBuffer<en_msg>& getInbox(int id) {
+		if ( id >= (int)inbox.size() ) {
+			inbox.resize(id + 1);
+		}
+		return inbox[id];
+	}
 	virtual ~EM() {}
 };
 
+/**
+ * Class Name: MsgCount
+ *
+ * DESCRIPTION: Message accounting for one node. Totals cover the whole run; per-tick
+ * 				counts are only kept for the most recent window of ticks.
+ */
+class MsgCount {
+public:
+	long sentTotal;
+	long recvTotal;
+	long sentBytes;
+	long recvBytes;
+	// slot tick % window holds the counts of the tick stored alongside them
+	vector<int> slotTick;
+	vector<int> sent;
+	vector<int> recv;
+	MsgCount(): sentTotal(0), recvTotal(0), sentBytes(0), recvBytes(0) {}
+	int *slot(vector<int> &counts, int time, int window) {
+		if ( window <= 0 ) {
+			return NULL;
+		}
+		if ( slotTick.empty() ) {
+			slotTick.assign(window, -1);
+			sent.assign(window, 0);
+			recv.assign(window, 0);
+		}
+		int i = time % window;
+		if ( slotTick[i] != time ) {
+			slotTick[i] = time;
+			sent[i] = 0;
+			recv[i] = 0;
+		}
+		return &counts[i];
+	}
+	void countSent(int time, int window, long bytes, int messages = 1) {
+		int *count = slot(sent, time, window);
+		if ( count ) {
+			*count += messages;
+		}
+		sentTotal += messages;
+		sentBytes += bytes;
+	}
+	void countRecv(int time, int window, int bytes) {
+		int *count = slot(recv, time, window);
+		if ( count ) {
+			(*count)++;
+		}
+		recvTotal++;
+		recvBytes += bytes;
+	}
+	int getSent(int time) {
+		int i = slotTick.empty() ? 0 : time % (int)slotTick.size();
+		return (!slotTick.empty() && slotTick[i] == time) ? sent[i] : 0;
+	}
+	int getRecv(int time) {
+		int i = slotTick.empty() ? 0 : time % (int)slotTick.size();
+		return (!slotTick.empty() && slotTick[i] == time) ? recv[i] : 0;
+	}
+	static void logAll(FILE *file, vector<MsgCount> &counts, Params *par);
+};
+
+/**
+ * Struct Name: RouteShard
+ *
+ * DESCRIPTION: Routing state of the destinations whose id modulo the number of shards is
+ * 				this shard's index. Routing to one shard touches nothing another one uses.
+ */
+typedef struct RouteShard {
+	// Delayed messages, keyed on the tick after which they become receivable
+	TimingWheel<en_msg> inflight;
+	// messages lost to MSG_DROP_PROB, to the EN_BUFFSIZE bound and to MAX_MSG_SIZE
+	long probDrops;
+	long capacityDrops;
+	long oversizeDrops;
+	RouteShard(): probDrops(0), capacityDrops(0), oversizeDrops(0) {}
+}RouteShard;
+
+/**
+ * Struct Name: en_staged
+ */
+typedef struct en_staged {
+	// Messages a node staged for one shard's destinations, in the order it sent them
+	vector<en_msg> msgs;
+	// How many of them ENcommitShard routed, and their bytes, until ENcommit counts them
+	int routed;
+	long bytes;
+	en_staged(): routed(0), bytes(0) {}
+}en_staged;
+
 /**
  * CLASS NAME: EmulNet
  *
  * DESCRIPTION: This class defines an emulated network
  */
-class EmulNet
+class EmulNet : public Transport
 { 	
 private:
 	Params* par;
-	int sent_msgs[MAX_NODES + 1][MAX_TIME];
-	int recv_msgs[MAX_NODES + 1][MAX_TIME];
+	// Message accounting indexed by node id, grown as nodes appear
+	vector<MsgCount> msgcount;
 	int enInited;
 	EM emulnet;
+	// One message pool per worker thread; a buffer goes back to the pool of the
+	// thread that releases it
+	vector<MsgPool *> pools;
+	// When set, ENsend only queues messages per sender and destination shard until
+	// ENcommitShard or ENcommit
+	bool staging;
+	vector< vector<en_staged> > outbox;
+	// One per worker thread; a single one while EN_BUFFSIZE, which counts every message
+	// in flight in routing order, is set
+	vector<RouteShard> shards;
+	// tick at which the message pool last had to go to the heap
+	int poolGrowthTick;
+	long lastHeapAllocs;
+	int peakBuffSize;
+	// drop decisions and jitter by destination id, so that what a node receives does not
+	// depend on how the destinations are sharded
+	vector<Random> rngs;
+	// EN_TRACE capture, or the EN_REPLAY trace that stands in for the senders
+	PacketTrace trace;
+	bool replaying;
+	MsgCount& getMsgCount(int id);
+	void initPools();
+	long poolHeapAllocs();
+	int route(en_msg &em);
+	void countRouted(int src, int messages, long bytes);
+	int send(en_msg &em);
+	int linkDelay(int src, int dst);
+	void deliverDue(int time);
 public:
  	EmulNet(Params *p);
  	EmulNet(EmulNet &anotherEmulNet);
@@ -93,6 +220,15 @@ public:
 	int ENsend(Address *myaddr, Address *toaddr, string data);
 	int ENsend(Address *myaddr, Address *toaddr, char *data, int size);
 	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
+	void ENrelease(char *data);
+	char *ENalloc(int size);
+	int ENsendShared(Address *myaddr, Address *toaddr, char *data, int size);
+	void ENbind(int shard);
+	void ENstage(bool on);
+	int ENcommit(Address *myaddr);
+	int ENshards();
+	void ENcommitShard(int shard);
+	void ENdeliver();
 	int ENcleanup();
 };
 
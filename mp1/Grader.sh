@@ -187,4 +187,63 @@ fi
 #	echo "Checking Accuracy..............0/10"
 #fi
 #echo "============================================"
+echo "============================================"
+echo "UDP Large Group Scenario (not graded)"
+echo "============================"
+# more local sockets than UdpNet moves per batch, all readable at once
+if [ $verbose -eq 0 ]; then
+	timeout 300 ./Application testcases/udplargegroup.conf > /dev/null
+else
+	timeout 300 ./Application testcases/udplargegroup.conf
+fi
+if [ $? -eq 0 ]; then
+	echo "Checking Termination...........ok"
+else
+	echo "Checking Termination...........FAILED"
+fi
+failednode=`grep "Node failed at time" dbg.log | sort -u | awk '{print $1}'`
+failcount=`grep removed dbg.log | sort -u | grep $failednode | wc -l`
+if [ $failcount -ge 99 ]; then
+	echo "Checking Completeness..........ok"
+else
+	echo "Checking Completeness..........FAILED"
+fi
+echo "============================================"
+echo "Rumor Retransmission Scenario (not graded)"
+echo "============================"
+if [ $verbose -eq 0 ]; then
+	./Application testcases/multifailure.conf > /dev/null
+else
+	./Application testcases/multifailure.conf
+fi
+# each node logs the rumors it queued, the copies it sent and the most it may send
+overcount=`grep "rumors:" stats.log | awk '{ if ($(NF-4) + 0 > $NF + 0) n++ } END { print n + 0 }'`
+rumorcount=`grep "rumors:" stats.log | wc -l`
+if [ $rumorcount -gt 0 ] && [ $overcount -eq 0 ]; then
+	echo "Checking Rumor Sends...........ok"
+else
+	echo "Checking Rumor Sends...........FAILED"
+fi
+echo "============================================"
+echo "SWIM Message Drop Scenario (not graded)"
+echo "============================"
+# lost probes make SWIM suspect live members, which must refute before they are removed
+if [ $verbose -eq 0 ]; then
+	./Application testcases/swimmsgdrop.conf > /dev/null
+else
+	./Application testcases/swimmsgdrop.conf
+fi
+failednode=`grep "Node failed at time" dbg.log | sort -u | awk '{print $1}'`
+failcount=`grep removed dbg.log | sort -u | grep $failednode | wc -l`
+if [ $failcount -ge 9 ]; then
+	echo "Checking Completeness..........ok"
+else
+	echo "Checking Completeness..........FAILED"
+fi
+accuracycount=`grep removed dbg.log | sort -u | grep -v $failednode | wc -l`
+if [ $accuracycount -eq 0 ] && [ $failcount -gt 0 ]; then
+	echo "Checking Accuracy..............ok"
+else
+	echo "Checking Accuracy..............FAILED"
+fi
 echo Final grade $grade
@@ -6,12 +6,17 @@
 
 #include "Log.h"
 
+static FILE *fp;
+static FILE *fp2;
+static int numwrites;
+
 /**
  * Constructor
  */
 Log::Log(Params *p) {
 	par = p;
 	firstTime = false;
+	staging = false;
 }
 
 /**
@@ -20,6 +25,9 @@ Log::Log(Params *p) {
 Log::Log(const Log &anotherLog) {
 	this->par = anotherLog.par;
 	this->firstTime = anotherLog.firstTime;
+	this->staging = anotherLog.staging;
+	this->staged = anotherLog.staged;
+	this->stagedStats = anotherLog.stagedStats;
 }
 
 /**
@@ -28,6 +36,9 @@ Log::Log(const Log &anotherLog) {
 Log& Log::operator = (const Log& anotherLog) {
 	this->par = anotherLog.par;
 	this->firstTime = anotherLog.firstTime;
+	this->staging = anotherLog.staging;
+	this->staged = anotherLog.staged;
+	this->stagedStats = anotherLog.stagedStats;
 	return *this;
 }
 
@@ -43,12 +54,10 @@ Log::~Log() {}
  */
 void Log::LOG(Address *addr, const char * str, ...) {
 
-	static FILE *fp;
-	static FILE *fp2;
 	va_list vararglist;
-	static char buffer[30000];
-	static int numwrites;
-	static char stdstring[30];
+	// formatting scratch space is per thread, so nodes on worker threads can log
+	static thread_local char buffer[30000];
+	static thread_local char stdstring[30];
 	static char stdstring2[40];
 	static char stdstring3[40]; 
 	static int dbg_opened=0;
@@ -70,7 +79,7 @@ void Log::LOG(Address *addr, const char * str, ...) {
 	}
 	else 
 
-	sprintf(stdstring, "%d.%d.%d.%d:%d ", addr->addr[0], addr->addr[1], addr->addr[2], addr->addr[3], *(short *)&addr->addr[4]);
+	sprintf(stdstring, "%d.%d.%d.%d:%d ", addr->addr[0], addr->addr[1], addr->addr[2], addr->addr[3], NodeId(*addr).getport());
 
 	va_start(vararglist, str);
 	vsprintf(buffer, str, vararglist);
@@ -87,25 +96,64 @@ void Log::LOG(Address *addr, const char * str, ...) {
 		firstTime = true;
 	}
 
-	if(memcmp(buffer, "#STATSLOG#", 10)==0){
-		fprintf(fp2, "\n %s", stdstring);
-		fprintf(fp2, "[%d] ", par->getcurrtime());
+	char prefix[64];
+	sprintf(prefix, "\n %s[%d] ", stdstring, par->getcurrtime());
+	string line = string(prefix) + buffer;
+	bool stats = (memcmp(buffer, "#STATSLOG#", 10)==0);
 
-		fprintf(fp2, buffer);
+	if(staging){
+		(stats ? stagedStats : staged)[NodeId(*addr).getid()] += line;
 	}
 	else{
-		fprintf(fp, "\n %s", stdstring);
-		fprintf(fp, "[%d] ", par->getcurrtime());
-		fprintf(fp, buffer);
-
+		write(stats ? fp2 : fp, line.c_str());
 	}
 
+}
+
+/**
+ * FUNCTION NAME: write
+ *
+ * DESCRIPTION: Append to one of the log files, flushing every MAXWRITES lines
+ */
+void Log::write(FILE *file, const char *line) {
+	fputs(line, file);
+
 	if(++numwrites >= MAXWRITES){
 		fflush(fp);
 		fflush(fp2);
 		numwrites=0;
 	}
+}
+
+/**
+ * FUNCTION NAME: stage
+ *
+ * DESCRIPTION: While staging, lines are kept per node instead of being written, so that
+ * 				nodes running on different threads can log; commit writes them out
+ */
+void Log::stage(bool on) {
+	staging = on;
+	if ( (int)staged.size() <= par->EN_GPSZ ) {
+		staged.resize(par->EN_GPSZ + 1);
+		stagedStats.resize(par->EN_GPSZ + 1);
+	}
+}
 
+/**
+ * FUNCTION NAME: commit
+ *
+ * DESCRIPTION: Write out the lines staged by this node
+ */
+void Log::commit(Address *addr) {
+	int id = NodeId(*addr).getid();
+	if ( !staged[id].empty() ) {
+		write(fp, staged[id].c_str());
+		staged[id].clear();
+	}
+	if ( !stagedStats[id].empty() ) {
+		write(fp2, stagedStats[id].c_str());
+		stagedStats[id].clear();
+	}
 }
 
 /**
@@ -114,8 +162,8 @@ void Log::LOG(Address *addr, const char * str, ...) {
  * DESCRIPTION: To Log a node add
  */
 void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
-	static char stdstring[100];
-	sprintf(stdstring, "Node %d.%d.%d.%d:%d joined at time %d", addedAddr->addr[0], addedAddr->addr[1], addedAddr->addr[2], addedAddr->addr[3], *(short *)&addedAddr->addr[4], par->getcurrtime());
+	char stdstring[100];
+	sprintf(stdstring, "Node %d.%d.%d.%d:%d joined at time %d", addedAddr->addr[0], addedAddr->addr[1], addedAddr->addr[2], addedAddr->addr[3], NodeId(*addedAddr).getport(), par->getcurrtime());
     LOG(thisNode, stdstring);
 }
 
@@ -125,7 +173,7 @@ void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
  * DESCRIPTION: To log a node remove
  */
 void Log::logNodeRemove(Address *thisNode, Address *removedAddr) {
-	static char stdstring[30];
-	sprintf(stdstring, "Node %d.%d.%d.%d:%d removed at time %d", removedAddr->addr[0], removedAddr->addr[1], removedAddr->addr[2], removedAddr->addr[3], *(short *)&removedAddr->addr[4], par->getcurrtime());
+	char stdstring[100];
+	sprintf(stdstring, "Node %d.%d.%d.%d:%d removed at time %d", removedAddr->addr[0], removedAddr->addr[1], removedAddr->addr[2], removedAddr->addr[3], NodeId(*removedAddr).getport(), par->getcurrtime());
     LOG(thisNode, stdstring);
 }
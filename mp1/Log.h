@@ -29,6 +29,11 @@ class Log{
 private:
 	Params *par;
 	bool firstTime;
+	// When set, lines are held per node id until commit
+	bool staging;
+	vector<string> staged;
+	vector<string> stagedStats;
+	void write(FILE *fp, const char *line);
 public:
 	Log(Params *p);
 	Log(const Log &anotherLog);
@@ -37,6 +42,8 @@ public:
 	void LOG(Address *, const char * str, ...);
 	void logNodeAdd(Address *, Address *);
 	void logNodeRemove(Address *, Address *);
+	void stage(bool on);
+	void commit(Address *);
 };
 
 #endif /* _LOG_H_ */
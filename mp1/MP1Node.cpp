@@ -12,16 +12,19 @@
 
 #include "MP1Node.h"
 
+
 /*
  * Note: You can change/add any functions in MP1Node.{h,cpp}
  */
 
+MsgRoute MP1Node::routes[MSG_TYPES][MSG_VERSIONS];
+
 /**
  * Overloaded Constructor of the MP1Node class
  * You can add new members to the class if you think it
  * is necessary for your logic to work
  */
-MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Address *address) {
+MP1Node::MP1Node(Member *member, Params *params, Transport *emul, Log *log, Address *address) {
     for( int i = 0; i < 6; i++ ) {
         NULLADDR[i] = 0;
     }
@@ -30,6 +33,27 @@ MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Addres
     this->log = log;
     this->par = params;
     this->memberNode->addr = *address;
+    this->trace.bind(params, &this->memberNode->addr);
+    this->rng.seed(par->SEED, RNG_STREAM_NODE + NodeId(*address).getid());
+    this->probing = false;
+    this->probeSeq = 0;
+    this->probeAcked = false;
+    this->probeStart = 0;
+    this->probeNext = 0;
+    this->neighborPending = false;
+    this->neighborSince = 0;
+    this->joinsSeen = 0;
+    this->rumorsQueued = 0;
+    this->rumorSends = 0;
+    this->digestDue = false;
+    for (int i = 0; i < DUMMYLASTMSGTYPE; i++) {
+        this->snapshots[i].data = NULL;
+    }
+    for (int i = 0; i < REJECT_REASONS; i++) {
+        this->rejected[i] = 0;
+    }
+    static bool registered = registerMessages();
+    (void)registered;
 }
 
 /**
@@ -59,7 +83,7 @@ int MP1Node::recvLoop() {
  */
 int MP1Node::enqueueWrapper(void *env, char *buff, int size) {
     Queue q;
-    return q.enqueue((queue<q_elt> *)env, (void *)buff, size);
+    return q.enqueue((RingBuffer<q_elt> *)env, (void *)buff, size);
 }
 
 /**
@@ -72,6 +96,7 @@ int MP1Node::enqueueWrapper(void *env, char *buff, int size) {
 void MP1Node::nodeStart(char *servaddrstr, short servport) {
     Address joinaddr;
     joinaddr = getJoinAddress();
+    memberNode->joinStart = par->getcurrtime();
 
     // Self booting routines
     if( initThisNode(&joinaddr) == -1 ) {
@@ -123,9 +148,8 @@ int MP1Node::initThisNode(Address *joinaddr) {
  * DESCRIPTION: Join the distributed system
  */
 int MP1Node::introduceSelfToGroup(Address *joinaddr) {
-    MessageHdr *msg;
 #ifdef DEBUGLOG
-    static char s[1024];
+    char s[1024];
 #endif
 
     if ( 0 == memcmp((char *)&(memberNode->addr.addr), (char *)&(joinaddr->addr), sizeof(memberNode->addr.addr))) {
@@ -133,16 +157,14 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
 #ifdef DEBUGLOG
         log->LOG(&memberNode->addr, "Starting up group...");
 #endif
-        memberNode->inGroup = true;
+        joinedGroup();
     }
     else {
-        size_t msgsize = sizeof(MessageHdr) + sizeof(joinaddr->addr) + sizeof(long);
-        msg = (MessageHdr *) malloc(msgsize * sizeof(char));
-
-        // create JOINREQ message: format of data is {struct Address myaddr}
-        msg->msgType = JOINREQ;
-        memcpy((char *)(msg+1), &memberNode->addr.addr, sizeof(memberNode->addr.addr));
-        memcpy((char *)(msg+1) + sizeof(memberNode->addr.addr), &memberNode->heartbeat, sizeof(long));
+        // create JOINREQ message: format of data is {struct Address myaddr, heartbeat}
+        char *body = allocMessage(JOINREQ, JoinReqWire::SIZE);
+        WireBuilder<JoinReqWire> msg(body, JoinReqWire::SIZE);
+        msg.set<JoinReqWire::From>(NodeId(memberNode->addr));
+        msg.set<JoinReqWire::Heartbeat>(memberNode->heartbeat);
 
 #ifdef DEBUGLOG
         sprintf(s, "Trying to join...");
@@ -150,9 +172,7 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
 #endif
 
         // send JOINREQ message to introducer member
-        emulNet->ENsend(&memberNode->addr, joinaddr, (char *)msg, msgsize);
-
-        free(msg);
+        sendMessage(joinaddr, body, JoinReqWire::SIZE);
     }
 
     return 1;
@@ -165,9 +185,24 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
  * DESCRIPTION: Wind up this node and clean up state
  */
 int MP1Node::finishUpThisNode(){
-    /*
-     * Your code goes here
-     */
+    //give the cached lists back to the network before it shuts down
+    for (int i = 0; i < DUMMYLASTMSGTYPE; i++) {
+        if (snapshots[i].data) {
+            emulNet->ENrelease(snapshots[i].data);
+            snapshots[i].data = NULL;
+        }
+    }
+
+#ifdef DEBUGLOG
+    if (rumorsQueued) {
+        log->LOG(&memberNode->addr, "#STATSLOG# rumors: %ld queued, %ld sent, at most %ld", rumorsQueued, rumorSends,
+                rumorsQueued * RUMOR_LAMBDA * (long)ceil(log2(par->EN_GPSZ + 1)));
+    }
+    if (rejected[REJECT_TRUNCATED] || rejected[REJECT_UNKNOWN] || rejected[REJECT_SIZE]) {
+        log->LOG(&memberNode->addr, "#STATSLOG# rejected %ld truncated, %ld unknown, %ld wrong size messages",
+                rejected[REJECT_TRUNCATED], rejected[REJECT_UNKNOWN], rejected[REJECT_SIZE]);
+    }
+#endif
     return 0;
 }
 
@@ -196,17 +231,6 @@ void MP1Node::nodeLoop() {
     return;
 }
 
-int MP1Node::getIdFromAddress(string address) {
-    size_t pos = address.find(":");
-    int id = stoi(address.substr(0, pos));
-    return id;
-}
-
-short MP1Node::getPortFromAddress(string address) {
-    size_t pos = address.find(":");
-    short port = (short)stoi(address.substr(pos + 1, address.size()-pos-1));
-    return port;
-}
 
 /**
  * FUNCTION NAME: checkMessages
@@ -221,42 +245,97 @@ void MP1Node::checkMessages() {
     while ( !memberNode->mp1q.empty() ) {
         ptr = memberNode->mp1q.front().elt;
         size = memberNode->mp1q.front().size;
-        memberNode->mp1q.pop();
+        memberNode->mp1q.pop_front();
         recvCallBack((void *)memberNode, (char *)ptr, size);
+        // The buffer belongs to the network's message pool; hand it back
+        emulNet->ENrelease((char *)ptr);
     }
+
+    answerJoins();
     return;
 }
 
+/**
+ * FUNCTION NAME: registerMessage
+ *
+ * DESCRIPTION: Route messages of msgType at version to handler, with bodies of minSize to
+ * maxSize bytes. A new message type only needs a value below MSG_TYPES and a call to this
+ * before the nodes start; recvCallBack itself does not change.
+ */
+void MP1Node::registerMessage(uint8_t msgType, uint8_t version, MsgHandler handler, int minSize, int maxSize) {
+    assert(version < MSG_VERSIONS && minSize <= maxSize && maxSize <= MSG_BODY_MAX);
+    MsgRoute &route = routes[msgType][version];
+    route.handler = handler;
+    route.minSize = minSize;
+    route.maxSize = maxSize;
+}
+
+/**
+ * FUNCTION NAME: registerMessages
+ *
+ * DESCRIPTION: Register the handlers of the MsgTypes this node sends
+ */
+bool MP1Node::registerMessages() {
+    static_assert(DUMMYLASTMSGTYPE <= MSG_TYPES, "MsgTypes must fit in a byte");
+    int hvMax = HvWire::SIZE + UCHAR_MAX * WIRE_ADDR_LEN;
+    int digestRepMax = DigestRepWire::SIZE + DIGEST_BUCKETS * (int)sizeof(uint64_t);
+
+    registerMessage(JOINREQ, MSG_VERSION, &MP1Node::joinReqHandler, JoinReqWire::SIZE, JoinReqWire::SIZE);
+    registerMessage(JOINREP, MSG_VERSION, &MP1Node::joinRepHandler, FromWire::SIZE, MSG_BODY_MAX);
+    registerMessage(HEARTBEATREQ, MSG_VERSION, &MP1Node::heartbeatReqHandler, FromWire::SIZE, MSG_BODY_MAX);
+    registerMessage(HEARTBEATREP, MSG_VERSION, &MP1Node::heartbeatRepHandler, FromWire::SIZE, HEARTBEATREP_MAX);
+    registerMessage(PING, MSG_VERSION, &MP1Node::pingHandler, SwimWire::SIZE, SWIM_MSG_MAX);
+    registerMessage(PING_REQ, MSG_VERSION, &MP1Node::pingReqHandler, SwimWire::SIZE, SWIM_MSG_MAX);
+    registerMessage(ACK, MSG_VERSION, &MP1Node::ackHandler, SwimWire::SIZE, SWIM_MSG_MAX);
+    registerMessage(FORWARD_JOIN, MSG_VERSION, &MP1Node::forwardJoinHandler, HvWire::SIZE, hvMax);
+    registerMessage(NEIGHBOR, MSG_VERSION, &MP1Node::neighborHandler, HvWire::SIZE, hvMax);
+    registerMessage(NEIGHBOR_REP, MSG_VERSION, &MP1Node::neighborRepHandler, HvWire::SIZE, hvMax);
+    registerMessage(DISCONNECT, MSG_VERSION, &MP1Node::disconnectHandler, HvWire::SIZE, hvMax);
+    registerMessage(SHUFFLE, MSG_VERSION, &MP1Node::shuffleHandler, HvWire::SIZE, hvMax);
+    registerMessage(SHUFFLE_REP, MSG_VERSION, &MP1Node::shuffleRepHandler, HvWire::SIZE, hvMax);
+    registerMessage(KEEPALIVE, MSG_VERSION, &MP1Node::keepAliveHandler, HvWire::SIZE, hvMax);
+    registerMessage(DIGEST, MSG_VERSION, &MP1Node::digestHandler, DigestWire::SIZE, DigestWire::SIZE);
+    registerMessage(DIGEST_REP, MSG_VERSION, &MP1Node::digestRepHandler, DigestRepWire::SIZE, digestRepMax);
+    registerMessage(DIGEST_SYNC, MSG_VERSION, &MP1Node::digestSyncHandler, DigestSyncWire::SIZE, MSG_BODY_MAX);
+    return true;
+}
+
 /**
  * FUNCTION NAME: recvCallBack
  *
- * DESCRIPTION: Message handler for different message types
+ * DESCRIPTION: Message handler for different message types. The handler comes straight
+ * out of the dispatch table; a message that is truncated, of a type or version nobody
+ * registered, or of a size its handler does not take is counted in rejected and dropped
+ * before any of it is parsed.
  */
 bool MP1Node::recvCallBack(void *env, char *data, int size ) {
-    /*
-     * Your code goes here
-     */
     if (size < (int)sizeof(MessageHdr)) {
-#ifdef DEBUGLOG
-        log->LOG(&memberNode->addr, "Message received with size less than MessageHdr. Ignored.");
-#endif
+        rejected[REJECT_TRUNCATED]++;
         return false;
     }
 
-    MessageHdr* messageHdr = (MessageHdr*) data;
-    MsgTypes msgType = messageHdr->msgType;
+    const MessageHdr *messageHdr = (const MessageHdr *) data;
+    if (messageHdr->length > size) {
+        rejected[REJECT_TRUNCATED]++;
+        return false;
+    }
+    if (messageHdr->version >= MSG_VERSIONS) {
+        rejected[REJECT_UNKNOWN]++;
+        return false;
+    }
 
-    if (msgType == JOINREQ) {
-        return joinReqHandler(env, data+sizeof(MessageHdr), size - sizeof(MessageHdr)); //no need for the msgType anymore, so move address right
-    } else if (msgType == JOINREP) {
-        return joinRepHandler(env, data + sizeof(MessageHdr), size - sizeof(MessageHdr)); //no need for the msgType anymore, so move address right
-    } else if (msgType == HEARTBEATREQ) {
-        return heartbeatReqHandler(env, data + sizeof(MessageHdr), size - sizeof(MessageHdr));
-    } else if (msgType == HEARTBEATREP){
-        return heartbeatRepHandler(env, data + sizeof(MessageHdr), size - sizeof(MessageHdr));
-    } else {
+    const MsgRoute &route = routes[messageHdr->msgType][messageHdr->version];
+    int bodySize = messageHdr->length - (int)sizeof(MessageHdr);
+    if (!route.handler) {
+        rejected[REJECT_UNKNOWN]++;
+        return false;
+    }
+    if (bodySize < route.minSize || bodySize > route.maxSize) {
+        rejected[REJECT_SIZE]++;
         return false;
     }
+
+    return (this->*route.handler)(env, data + sizeof(MessageHdr), bodySize);
 }
 
 /**
@@ -264,41 +343,40 @@ bool MP1Node::recvCallBack(void *env, char *data, int size ) {
  *
  * DESCRIPTION: Handler for JOINREQ messages
  */
-bool MP1Node::joinReqHandler(void *env, char *data, int size) {
-    cout << "start joinReqHandler..." << endl;
+bool MP1Node::joinReqHandler(void *, char *data, int size) {
+    TraceScope<TRACE_JOIN> scope(trace, "joinReqHandler");
 
-    if (size < (int)(sizeof(memberNode->addr.addr) + sizeof(long))) {
+    WireView<JoinReqWire> msg(data, size);
+    if (!msg.valid()) {
 #ifdef DEBUGLOG
         log->LOG(&memberNode->addr, "Message JOINREQ received with size wrong. Ignored.");
 #endif
-        return false;
+        return scope.result(false);
     }
 
     //Get requester information
-    //message structure ---> MsgType, address, number of members, member data (id, port, heartbeat)
-    Address requesterAddress;
-    memcpy(requesterAddress.addr, data, sizeof(memberNode->addr.addr));     //extract requester's Address from data
-    data += sizeof(memberNode->addr.addr);
-    size -= sizeof(memberNode->addr.addr);
-
-    long heartbeat;
-    memcpy(&heartbeat, data, sizeof(long));   //extract heartbeat from data
-    //data += sizeof(long);
-    //size -= sizeof(long);
-
-    //Get id and port
-    string reqAddStr = (requesterAddress.getAddress());
-    int id = getIdFromAddress(reqAddStr);
-    short port = getPortFromAddress(reqAddStr);
+    NodeId requester = msg.get<JoinReqWire::From>();
+    long heartbeat = (long)msg.get<JoinReqWire::Heartbeat>();
+
+    //HyParView keeps no membership list; the requester joins the views instead
+    if (par->PROTOCOL == HYPARVIEW_PROTOCOL) {
+        hvJoin(requester);
+        return scope.result(true);
+    }
 
     //update the member in the membership list
-    updateMembershipList(id, port, heartbeat);
+    updateMembershipList(requester, heartbeat);
 
-    //send membership list to requester
-    sendMembershipList(&requesterAddress, JOINREP);
+    //send membership list to requester, or to all of this tick's requesters at once
+    Address requesterAddress(requester);
+    if (par->JOIN_BATCH) {
+        pendingJoins.push_back(requesterAddress);
+    }
+    else {
+        sendMembershipList(&requesterAddress, JOINREP);
+    }
 
-    cout << "...end joinReqHandler." << endl;
-    return true;
+    return scope.result(true);
 }
 
 
@@ -307,25 +385,50 @@ bool MP1Node::joinReqHandler(void *env, char *data, int size) {
  *
  * DESCRIPTION: Handler for JOINREP messages
  */
-bool MP1Node::joinRepHandler(void *env, char *data, int size) {
-    cout << "start joinRepHandler..." << endl;
+bool MP1Node::joinRepHandler(void *, char *data, int size) {
+    TraceScope<TRACE_JOIN> scope(trace, "joinRepHandler");
 
-    if (size < (int)(sizeof(memberNode->addr.addr))) {
-        return false;
+    WireView<FromWire> msg(data, size);
+    if (!msg.valid()) {
+        return scope.result(false);
     }
 
-    Address replierAddr;
-    memcpy(replierAddr.addr, data, sizeof(memberNode->addr.addr));          //extract replier's Address from data
-    data += sizeof(memberNode->addr.addr);
-    size -= sizeof(memberNode->addr.addr);
+    WireReader list = msg.rest();
+    if (!recvMembershipList(list, "JOINREP")) {
+        return scope.result(false);
+    }
+    joinedGroup();
 
-    if (!recvMembershipList(env, data, size, "JOINREP")) {
-        return false;
+    return scope.result(true);
+}
+
+/**
+ * FUNCTION NAME: answerJoins
+ *
+ * DESCRIPTION: Send the JOINREPs held back by JOIN_BATCH. Every requester has been added
+ * by now, so they all get one membership list, encoded once and shared.
+ */
+void MP1Node::answerJoins() {
+    for (size_t i = 0; i < pendingJoins.size(); i++) {
+        sendMembershipList(&pendingJoins[i], JOINREP);
     }
-    this->memberNode->inGroup = true;
+    pendingJoins.clear();
+}
 
-    cout << "...end joinRepHandler." << endl;
-    return true;
+/**
+ * FUNCTION NAME: joinedGroup
+ *
+ * DESCRIPTION: Enter the group, recording in stats.log how long joining took
+ */
+void MP1Node::joinedGroup() {
+    if (memberNode->inGroup) {
+        return;
+    }
+    memberNode->inGroup = true;
+    memberNode->joinTicks = par->getcurrtime() - memberNode->joinStart;
+#ifdef DEBUGLOG
+    log->LOG(&memberNode->addr, "#STATSLOG# joined after %d ticks", memberNode->joinTicks);
+#endif
 }
 
 /**
@@ -337,64 +440,64 @@ bool MP1Node::joinRepHandler(void *env, char *data, int size) {
  * msgType. When the requester node receives this node's message, this node's heartbeat number
  * is increased in the requester node's membership list.
  */
-bool MP1Node::heartbeatReqHandler(void *env, char *data, int size) {
-    cout << "start heartbeatReqHandler..." << endl;
+bool MP1Node::heartbeatReqHandler(void *, char *data, int size) {
+    TraceScope<TRACE_GOSSIP> scope(trace, "heartbeatReqHandler");
 
-    if (size < (int)(sizeof(memberNode->addr.addr))) {
-        return false;
+    WireView<FromWire> req(data, size);
+    if (!req.valid()) {
+        return scope.result(false);
     }
 
-    Address requesterAddr;
-    memcpy(requesterAddr.addr, data, sizeof(memberNode->addr.addr));    //extract Address from data
-    data += sizeof(memberNode->addr.addr);
-    size -= sizeof(memberNode->addr.addr);
-
-    if (!recvMembershipList(env, data, size, "HEARTBEATREQ")) {         //extract membership list from the message
-        return false;                                                   //and push the data into own membership list
+    WireReader list = req.rest();
+    if (!recvMembershipList(list, "HEARTBEATREQ")) {         //extract membership list from the message
+        return scope.result(false);                         //and push the data into own membership list
     }
 
-    //construct message of structure [msgType, address]
-    size_t msgSize = sizeof(MessageHdr) + sizeof(memberNode->addr.addr);
-    MessageHdr *msg = (MessageHdr*) malloc (msgSize);
-    msg->msgType = HEARTBEATREP;
-    memcpy((char*)(msg + 1), &memberNode->addr.addr, sizeof(memberNode->addr.addr));
+    //construct message of structure [address, rumors]
+    char *body = allocMessage(HEARTBEATREP, HEARTBEATREP_MAX);
+    WireBuilder<FromWire> rep(body, HEARTBEATREP_MAX);
+    rep.set<FromWire::From>(NodeId(memberNode->addr));
+    WireWriter out = rep.rest();
+    int carried = par->SUSPICION ? writeRumors(out) : 0;
 
-    emulNet->ENsend(&memberNode->addr, &requesterAddr,(char*)msg, msgSize);
-    free(msg);
+    Address requesterAddr(req.get<FromWire::From>());
+    sendMessage(&requesterAddr, body, FromWire::SIZE + out.size());
+    rumorSends += carried;
 
-    cout << "...end heartbeatReqHandler." << endl;
-    return true;
+    return scope.result(true);
 }
 
 /**
  * FUNCTION NAME: heartbeatRepHandler
  *
  * DESCRIPTION: Handler for HEARTBEATREP messages. When a HEARTBEATREP message is received from a replier,
- * increase the replier's heartbeat number in own membership list.
+ * increase the replier's heartbeat number in own membership list, and take in the rumors it carries.
+ * With HEARTBEAT_EPOCH above 1 only the replier counts its heartbeats, or it would find its
+ * next one already taken; the reply still shows it is alive.
  */
-bool MP1Node::heartbeatRepHandler(void *env, char *data, int size) {
-    cout << "start heartbeatRepHandler..." << endl;
+bool MP1Node::heartbeatRepHandler(void *, char *data, int size) {
+    TraceScope<TRACE_GOSSIP> scope(trace, "heartbeatRepHandler");
 
-    if (size < (int)(sizeof(memberNode->addr.addr))) {
-        return false;
+    WireView<FromWire> msg(data, size);
+    if (!msg.valid()) {
+        return scope.result(false);
     }
 
-    Address replierAddr;
-    memcpy(&replierAddr.addr, data, sizeof(memberNode->addr.addr));
-
-    int id = getIdFromAddress(replierAddr.getAddress());
-    short port = getPortFromAddress(replierAddr.getAddress());
+    WireReader rumors = msg.rest();
+    if (!rumors.empty()) {
+        readRumors(rumors);
+    }
 
-    for (vector<MemberListEntry>::iterator entry = memberNode->memberList.begin(); entry != memberNode->memberList.end(); entry++) {
-        if (entry->id == id && entry->port == port) {
-            entry->settimestamp( par->getcurrtime() );
-            entry->heartbeat = entry->heartbeat + 1;
-            return true;
+    MemberListEntry *entry = memberNode->findMember(msg.get<FromWire::From>());
+    if (entry) {
+        heartbeatArrived(entry);
+        if (par->HEARTBEAT_EPOCH == 1) {
+            memberNode->setHeartbeat(entry, entry->heartbeat + 1);
         }
+        return scope.result(true);
     }
 
-    cout << "...end heartbeatRepHandler." << endl;
-    return false;
+    return scope.result(false);
 }
 
 /**
@@ -402,158 +505,464 @@ bool MP1Node::heartbeatRepHandler(void *env, char *data, int size) {
  *
  * DESCRIPTION: update the member passed into the argument in own member list. If the
  * member list does not contain the entry, create a new MemberListEntry and push it into
- * the list.
+ * the list. Returns true if the member was new.
  */
-void MP1Node::updateMembershipList(int id, short port, long heartbeat) {
-    cout << "updating membership list ..." << endl;
+bool MP1Node::updateMembershipList(NodeId node, long heartbeat) {
+    TraceScope<TRACE_MEMBERS> scope(trace, "updateMembershipList");
+
+    MemberListEntry *known = memberNode->findMember(node);
+    if (known) {
+        if (heartbeat > known->getheartbeat()) {
+            memberNode->setHeartbeat(known, heartbeat);
+            heartbeatArrived(known);
+        }
+        return scope.result(false);
+    }
 
-    int sizeOfMemberList = this->memberNode->memberList.size();
-    for (int i = 0; i < sizeOfMemberList; i++) {
-        if (memberNode->memberList[i].id == id && memberNode->memberList[i].port == port) {
-            if (heartbeat > memberNode->memberList[i].getheartbeat()) {
-                memberNode->memberList[i].heartbeat = heartbeat;
-                memberNode->memberList[i].settimestamp(par->getcurrtime());
-            }
-            return;
+    //SWIM only takes back a failure the member itself refutes, see readUpdates
+    if (par->PROTOCOL == SWIM_PROTOCOL && deadNodes.count(node)) {
+        return scope.result(false);
+    }
+
+    //nor does gossip take back a removal, unless the member has heartbeat since
+    auto tomb = removed.find(node);
+    if (tomb != removed.end()) {
+        if (heartbeat <= tomb->second.heartbeat) {
+            return scope.result(false);
         }
+        removed.erase(tomb);
     }
 
     //if the memberlist does not contain the entry, create a new one and push it into the list
-    MemberListEntry entry(id, port, heartbeat, par->getcurrtime());
-    memberNode->memberList.push_back(entry);
+    MemberListEntry entry(node, heartbeat, par->getcurrtime());
+    memberNode->addMember(entry);
 
 #ifdef DEBUGLOG
-    Address logAddr;
-    memcpy(&logAddr.addr[0], &entry.id, sizeof(int));
-    memcpy(&logAddr.addr[4], &entry.port, sizeof(short));
+    Address logAddr(node);
     log->logNodeAdd(&memberNode->addr, &logAddr);
 #endif
 
-    cout << "...end updateMembershipList." << endl;
+    //let the rest of the group know through the probes, or start timing it out
+    if (par->PROTOCOL == SWIM_PROTOCOL) {
+        addUpdate(node, SWIM_ALIVE, 0);
+    }
+    else {
+        scheduleExpiry(entry);
+    }
+
+    return scope.result(true);
 }
 
 /**
  * FUNCTION NAME: updateMembershipList
  *
- * DESCRIPTION: update the membership list and update heartbeats
+ * DESCRIPTION: update the membership list and update heartbeats. A newer incarnation means
+ * the member has refuted whatever was said about the older one.
  */
 void MP1Node::updateMembershipList(MemberListEntry& entry) {
-    updateMembershipList(entry.getid(), entry.getport(), entry.getheartbeat());
+    updateMembershipList(entry.getnodeid(), entry.getheartbeat());
+
+    MemberListEntry *known = memberNode->findMember(entry.getnodeid());
+    if (known && entry.incarnation > known->incarnation) {
+        known->incarnation = entry.incarnation;
+        known->state = MEMBER_ALIVE;
+        memberNode->touchMember(known);
+    }
 }
 
 
 /**
  * FUNCTION NAME: sendMembershipList
  *
- * DESCRIPTION: send a membership list to a node
+ * DESCRIPTION: send a membership list to a node. With GOSSIP: DELTA a HEARTBEATREQ only
+ * carries the entries that changed in the last DELTA_ROUNDS rounds, so each change goes
+ * out to that many random members and spreads from them as it would from a full list.
+ * Every FULL_SYNC_PERIOD-th round still sends them all, for the members it missed.
+ * GOSSIP: DIGEST always sends the delta and repairs with a DIGEST instead, on the first of
+ * those rounds with nothing left in the delta: compared while heartbeats are still
+ * spreading, digests would differ even between tables about to agree.
  */
 void MP1Node::sendMembershipList(Address *to, enum MsgTypes msgType) {
-    cout << "start sendMembershipList ..." << endl;
+    TraceScope<TRACE_GOSSIP> scope(trace, "sendMembershipList");
+
+    //entries up to this version need not be sent again
+    long known = 0;
+    bool sync = false;
+    if (msgType == HEARTBEATREQ) {
+        vector<long> &rounds = memberNode->roundVersions;
+        if (rounds.empty()) {
+            rounds.assign(par->DELTA_ROUNDS, 0);
+        }
+        long &since = rounds[memberNode->gossipRounds % rounds.size()];
+        sync = memberNode->gossipRounds % par->FULL_SYNC_PERIOD == 0;
+        if ((par->GOSSIP == DELTA_GOSSIP && !sync) || par->GOSSIP == DIGEST_GOSSIP) {
+            known = since;
+        }
+        since = memberNode->listVersion;
+        memberNode->gossipRounds++;
+    }
 
-    long numberOfMembers = memberNode->memberList.size();
-    //message structure: [MessageHdr] [Address] [Number of members] [Members...]
-    size_t msgsize = sizeof(MessageHdr) + sizeof(memberNode->addr.addr) + sizeof(long) + (numberOfMembers * (sizeof(int) + sizeof(short) + sizeof(log)));
+    //rumors are counted per copy sent, so a list carrying them is never shared
+    bool withRumors = msgType == HEARTBEATREQ && par->SUSPICION && !rumors.empty();
 
-    //malloc memory space for the header
-    MessageHdr* msg = (MessageHdr *) malloc(msgsize * sizeof(char));
+    //full lists are encoded once per table version and tick and shared by every receiver
+    if (known == 0 && !withRumors) {
+        Snapshot &snap = snapshots[msgType];
+        if (!snap.data || snap.version != memberNode->listVersion || snap.time != par->getcurrtime()) {
+            if (snap.data) {
+                emulNet->ENrelease(snap.data);
+            }
+            snap.data = buildMembershipList(msgType, 0, NULL, &snap.size);
+            snap.version = memberNode->listVersion;
+            snap.time = par->getcurrtime();
+        }
+        emulNet->ENsendShared(&memberNode->addr, to, snap.data, snap.size);
+    }
+    else {
+        int size, carried = 0;
+        char *msg = buildMembershipList(msgType, known, withRumors ? &carried : NULL, &size);
+        emulNet->ENsendShared(&memberNode->addr, to, msg, size);
+        emulNet->ENrelease(msg);
+        rumorSends += carried;
+    }
 
-    //msg will be a pointer to an address
-    char* data = (char*) (msg + 1);
+    if (sync && par->GOSSIP == DIGEST_GOSSIP) {
+        digestDue = true;
+    }
+    if (digestDue && msgType == HEARTBEATREQ && known == memberNode->listVersion) {
+        sendDigest(to);
+        digestDue = false;
+    }
 
-    //set the message type
-    msg->msgType = msgType;
+}
+
+/**
+ * FUNCTION NAME: collectMembers
+ *
+ * DESCRIPTION: Fill outgoing with the members to send: those changed since version known,
+ * in the digest buckets set in the mask, leaving out the failed
+ */
+void MP1Node::collectMembers(long known, uint64_t buckets) {
+    //expireMembers has already removed those past removeAfter
+    outgoing.clear();
+    for (int i = 0; i < (int)memberNode->memberList.size(); i++) {
+        MemberListEntry *entry = &memberNode->memberList[i];
+        //dont copy the failed not into the data; SWIM only drops members that failed a probe
+        if (i != 0 && par->PROTOCOL == GOSSIP_PROTOCOL && par->getcurrtime() - entry->timestamp > failAfter(*entry)) {
+            continue;
+        }
+        //the receiver already has this version of the entry
+        if (entry->version <= known) {
+            continue;
+        }
+        if (buckets != ~0ULL && !(buckets >> MembershipDigest::bucketOf(entry->getnodeid().v) & 1)) {
+            continue;
+        }
+        outgoing.push_back(entry);
+    }
+}
+
+/**
+ * FUNCTION NAME: buildMembershipList
+ *
+ * DESCRIPTION: Encode a membership list message, leaving out the entries up to version
+ * known, into a buffer from the transport that the caller must ENrelease. Given
+ * rumorCount, the rumors follow the list and their number is stored there; writeRumors
+ * counts them as sent, so that message must go to exactly one receiver.
+ */
+char *MP1Node::buildMembershipList(enum MsgTypes msgType, long known, int *rumorCount, int *size) {
+    collectMembers(known, ~0ULL);
+
+    //message structure: [MessageHdr] [Address] [LIST_VERSION] [Number of members] [Members...],
+    //then given rumorCount [Rumors]
+    int capacity = FromWire::SIZE + LIST_MAX(outgoing.size()) + (rumorCount ? RUMORS_MAX : 0);
+    char *body = allocMessage(msgType, capacity);
+    WireBuilder<FromWire> msg(body, capacity);
 
     //set this node's address into the message
-    memcpy(data, &memberNode->addr.addr, sizeof(memberNode->addr.addr));
-    data += sizeof(memberNode->addr.addr);
-
-    //set the number of members (for now)
-    char* numberOfMembersPtr = data;
-    memcpy(numberOfMembersPtr, &numberOfMembers, sizeof(long));
-    data += sizeof(long);
-
-    //set the members in list and delete members that have failed
-    for (vector<MemberListEntry>::iterator entry = memberNode->memberList.begin(); entry != memberNode->memberList.end();) {
-        if (entry != memberNode->memberList.begin()) {
-            if (par->getcurrtime() - entry->timestamp > TREMOVE) {
+    msg.set<FromWire::From>(NodeId(memberNode->addr));
+
+    WireWriter out = msg.rest();
+    encodeMembershipList(out);
+    if (rumorCount) {
+        *rumorCount = writeRumors(out);
+    }
+    assert(out.ok());
+
+    //send only the bytes the list took up
+    *size = sizeof(MessageHdr) + FromWire::SIZE + out.size();
+    assert(*size <= USHRT_MAX);
+    MessageHdr *hdr = (MessageHdr *)(body - sizeof(MessageHdr));
+    hdr->length = (uint16_t)*size;
+    return (char *)hdr;
+}
+
+/**
+ * FUNCTION NAME: allocMessage
+ *
+ * DESCRIPTION: Take a buffer from the transport for a message of type msgType with up to
+ * bodySize bytes after the MessageHdr, and return where the body goes
+ */
+char *MP1Node::allocMessage(enum MsgTypes msgType, int bodySize) {
+    MessageHdr *msg = (MessageHdr *) emulNet->ENalloc(sizeof(MessageHdr) + bodySize);
+    msg->msgType = msgType;
+    msg->version = MSG_VERSION;
+    return (char *)(msg + 1);
+}
+
+/**
+ * FUNCTION NAME: sendMessage
+ *
+ * DESCRIPTION: Send the message whose body allocMessage returned, bodySize bytes of it,
+ * and hand its buffer back
+ */
+void MP1Node::sendMessage(Address *to, char *body, int bodySize) {
+    char *msg = body - sizeof(MessageHdr);
+    assert(bodySize <= MSG_BODY_MAX);
+    ((MessageHdr *)msg)->length = (uint16_t)(sizeof(MessageHdr) + bodySize);
+    emulNet->ENsendShared(&memberNode->addr, to, msg, sizeof(MessageHdr) + bodySize);
+    emulNet->ENrelease(msg);
+}
+
+/**
+ * FUNCTION NAME: entryOrder
+ *
+ * DESCRIPTION: Order of the entries in an encoded membership list: by id, then port
+ */
+bool MP1Node::entryOrder(const MemberListEntry *a, const MemberListEntry *b) {
+    if (a->id != b->id) {
+        return (uint32_t)a->id < (uint32_t)b->id;
+    }
+    return (uint16_t)a->port < (uint16_t)b->port;
+}
+
+/**
+ * FUNCTION NAME: encodeMembershipList
+ *
+ * DESCRIPTION: write the entries in outgoing at out, in LIST_VERSION format:
+ * [LIST_VERSION] [varint count] then per entry, sorted by entryOrder,
+ * [varint (id - previous id) << 2 | incarnation given << 1 | port given] [zigzag port, if given]
+ * [zigzag heartbeat - previous heartbeat] [varint incarnation, if given].
+ * Ports are only written when they are not 0, the port every node uses today, and
+ * incarnations when a member has had to refute a suspicion.
+ * out needs room for LIST_MAX(outgoing.size()).
+ */
+void MP1Node::encodeMembershipList(WireWriter &out) {
+    sort(outgoing.begin(), outgoing.end(), entryOrder);
+
+    out.put<uint8_t>(LIST_VERSION);
+    out.varint(outgoing.size());
+
+    uint32_t prevId = 0;
+    long prevHeartbeat = 0;
+    for (size_t i = 0; i < outgoing.size(); i++) {
+        MemberListEntry *entry = outgoing[i];
+        uint64_t key = (uint64_t)((uint32_t)entry->id - prevId) << 2;
+        if (entry->port != 0) {
+            key |= 1;
+        }
+        if (entry->incarnation != 0) {
+            key |= 2;
+        }
+        out.varint(key);
+        if (entry->port != 0) {
+            out.varint(zigzagEncode(entry->port));
+        }
+        out.varint(zigzagEncode(entry->heartbeat - prevHeartbeat));
+        if (entry->incarnation != 0) {
+            out.varint(entry->incarnation);
+        }
+        prevId = (uint32_t)entry->id;
+        prevHeartbeat = entry->heartbeat;
+    }
+}
+
+/**
+ * FUNCTION NAME: recvMembershipList
+ *
+ * DESCRIPTION: receive a membership list from another node. Make necessary updates to own membership list.
+ * The whole list is decoded before any of it is applied, so a malformed list changes nothing.
+ */
+bool MP1Node::recvMembershipList(WireReader &in, const char * label) {
+    if (in.get<uint8_t>() != LIST_VERSION) {
 #ifdef DEBUGLOG
-                Address toAddr;
-                memcpy(&toAddr.addr[0], &entry->id, sizeof(int));
-                memcpy(&toAddr.addr[4], &entry->port, sizeof(short));
-                log->logNodeRemove(&memberNode->addr, &toAddr);
+        log->LOG(&memberNode->addr, "Message %s received with an unknown list format. Ignored.", label);
 #endif
-                entry = memberNode->memberList.erase(entry);
-                numberOfMembers--;
-                continue;
-            }
-            //dont copy the failed not into the data
-            if (par->getcurrtime() - entry->timestamp > TFAIL) {
-                numberOfMembers--;
-                ++entry;
-                continue;
-            }
+        return false;
+    }
+
+    //every entry takes at least two bytes
+    uint64_t numberOfMembers = in.varint();
+    if (!in.ok() || numberOfMembers > (uint64_t)in.left() / 2) {
+        return false;
+    }
+
+    //extract each member from data
+    incoming.clear();
+    uint32_t id = 0;
+    long heartbeat = 0;
+    for (uint64_t i = 0; i < numberOfMembers; i++) {
+        uint64_t key = in.varint();
+        uint64_t port = (key & 1) ? in.varint() : 0;
+        uint64_t heartbeatDelta = in.varint();
+        uint64_t incarnation = (key & 2) ? in.varint() : 0;
+        if (!in.ok()) {
+            return false;
         }
+        id += (uint32_t)(key >> 2);
+        heartbeat += (long)zigzagDecode(heartbeatDelta);
+        incoming.push_back(MemberListEntry(NodeId((int)id, (short)zigzagDecode(port)), heartbeat, par->getcurrtime()));
+        incoming.back().incarnation = (long)incarnation;
+    }
 
-        memcpy(data, &entry->id, sizeof(int));
-        data += sizeof(int);
-        memcpy(data, &entry->port, sizeof(short));
-        data += sizeof(short);
-        memcpy(data, &entry->heartbeat, sizeof(long));
-        data += sizeof(long);
+    //update own membership list
+    for (size_t i = 0; i < incoming.size(); i++) {
+        updateMembershipList(incoming[i]);
+    }
 
-        ++entry;
+    //a HEARTBEATREQ may carry rumors after the list
+    if (!in.empty()) {
+        return readRumors(in);
     }
 
-    //set new number of members members were deleted
-    memcpy(numberOfMembersPtr, &numberOfMembers, sizeof(long));
+    return true;
+}
+
+/**
+ * FUNCTION NAME: sendDigest
+ *
+ * DESCRIPTION: Start an anti-entropy exchange with a member: [Address] [root]. A member
+ * whose table holds the same members at the same heartbeats has nothing to say, so between
+ * converged tables the exchange costs this one message.
+ */
+void MP1Node::sendDigest(Address *to) {
+    char *body = allocMessage(DIGEST, DigestWire::SIZE);
+    WireBuilder<DigestWire> msg(body, DigestWire::SIZE);
+    msg.set<DigestWire::From>(NodeId(memberNode->addr));
+    msg.set<DigestWire::Root>(memberNode->digest.root());
+
+    sendMessage(to, body, DigestWire::SIZE);
+}
+
+/**
+ * FUNCTION NAME: digestHandler
+ *
+ * DESCRIPTION: Handler for DIGEST messages. If the roots differ, answer with the buckets:
+ * [Address] [mask of the non-empty buckets] [the hash of each, in order]
+ */
+bool MP1Node::digestHandler(void *, char *data, int size) {
+    TraceScope<TRACE_GOSSIP> scope(trace, "digestHandler");
 
-    //read new message size in case members were deleted
-    msgsize = sizeof(MessageHdr) + sizeof(memberNode->addr.addr) + sizeof(long) + (numberOfMembers * (sizeof(int) + sizeof(short) + sizeof(log)));
+    WireView<DigestWire> req(data, size);
+    if (!req.valid()) {
+        return scope.result(false);
+    }
 
-    //send membership list through network
-    emulNet->ENsend(&memberNode->addr, to, (char *)msg, msgsize);   //send the membership list to network
-    free(msg);
+    NodeId requester = req.get<DigestWire::From>();
+    if (req.get<DigestWire::Root>() == memberNode->digest.root()) {
+        return scope.result(true);
+    }
+    trace.event<TRACE_INFO, TRACE_GOSSIP>("digest differs from", requester.getid());
+
+    int capacity = DigestRepWire::SIZE + DIGEST_BUCKETS * sizeof(uint64_t);
+    char *body = allocMessage(DIGEST_REP, capacity);
+    WireBuilder<DigestRepWire> rep(body, capacity);
+    rep.set<DigestRepWire::From>(NodeId(memberNode->addr));
+
+    uint64_t mask = 0;
+    WireWriter out = rep.rest();
+    for (int i = 0; i < DIGEST_BUCKETS; i++) {
+        uint64_t hash = memberNode->digest.bucket(i);
+        if (hash != 0) {
+            mask |= 1ULL << i;
+            out.put<uint64_t>(hash);
+        }
+    }
+    rep.set<DigestRepWire::Mask>(mask);
 
-    cout << "...end sendMembershipList." << endl;
+    Address requesterAddr(requester);
+    sendMessage(&requesterAddr, body, DigestRepWire::SIZE + out.size());
+    return scope.result(true);
 }
 
 /**
- * FUNCTION NAME: recvMembershipList
+ * FUNCTION NAME: digestRepHandler
  *
- * DESCRIPTION: receive a membership list from another node. Make necessary updates to own membership list.
+ * DESCRIPTION: Handler for DIGEST_REP messages. Send the members in the buckets that differ
+ * from ours, asking for the replier's members in them in return.
  */
-bool MP1Node::recvMembershipList(void *env, char *data, int size, const char * label) {
+bool MP1Node::digestRepHandler(void *, char *data, int size) {
+    TraceScope<TRACE_GOSSIP> scope(trace, "digestRepHandler");
 
-    //get the number of members
-    long numberOfMembers;
-    memcpy(&numberOfMembers, data, sizeof(long));
-    data += sizeof(long);
-    size -= sizeof(long);
+    WireView<DigestRepWire> rep(data, size);
+    if (!rep.valid()) {
+        return scope.result(false);
+    }
 
-    if (size < (int)(numberOfMembers * (sizeof(int) + sizeof(short) + sizeof(log)))) {
-        return false;
+    uint64_t mask = rep.get<DigestRepWire::Mask>();
+    WireReader in = rep.rest();
+    uint64_t differ = 0;
+    for (int i = 0; i < DIGEST_BUCKETS; i++) {
+        uint64_t theirs = (mask >> i & 1) ? in.get<uint64_t>() : 0;
+        if (theirs != memberNode->digest.bucket(i)) {
+            differ |= 1ULL << i;
+        }
+    }
+    if (!in.ok()) {
+        return scope.result(false);
     }
 
-    //extract each member from data and update own membership list
-    MemberListEntry entry;
-    for (int i = 0; i < numberOfMembers; i++) {
+    if (differ != 0) {
+        Address replierAddr(rep.get<DigestRepWire::From>());
+        sendDigestSync(&replierAddr, differ, true);
+    }
+    return scope.result(true);
+}
 
-        memcpy(&entry.id, data, sizeof(int));
-        data += sizeof(int);
-        memcpy(&entry.port, data, sizeof(short));
-        data += sizeof(short);
-        memcpy(&entry.heartbeat, data, sizeof(long));
-        data += sizeof(long);
-        entry.timestamp = par->getcurrtime();
+/**
+ * FUNCTION NAME: sendDigestSync
+ *
+ * DESCRIPTION: Send the members in the buckets set in the mask:
+ * [Address] [mask] [reply wanted] [membership list]
+ */
+void MP1Node::sendDigestSync(Address *to, uint64_t buckets, bool reply) {
+    collectMembers(0, buckets);
+
+    int capacity = DigestSyncWire::SIZE + LIST_MAX(outgoing.size());
+    char *body = allocMessage(DIGEST_SYNC, capacity);
+    WireBuilder<DigestSyncWire> msg(body, capacity);
+    msg.set<DigestSyncWire::From>(NodeId(memberNode->addr));
+    msg.set<DigestSyncWire::Buckets>(buckets);
+    msg.set<DigestSyncWire::Reply>(reply ? 1 : 0);
+    WireWriter out = msg.rest();
+    encodeMembershipList(out);
+
+    sendMessage(to, body, DigestSyncWire::SIZE + out.size());
+}
 
-        int id = entry.id;
-        short port = entry.port;
-        long heartbeat = entry.heartbeat;
+/**
+ * FUNCTION NAME: digestSyncHandler
+ *
+ * DESCRIPTION: Handler for DIGEST_SYNC messages. Merge the members sent, and if asked,
+ * send back ours in the same buckets.
+ */
+bool MP1Node::digestSyncHandler(void *, char *data, int size) {
+    TraceScope<TRACE_GOSSIP> scope(trace, "digestSyncHandler");
 
-        updateMembershipList(id, port, heartbeat);
+    WireView<DigestSyncWire> msg(data, size);
+    if (!msg.valid()) {
+        return scope.result(false);
     }
 
-    return true;
+    WireReader list = msg.rest();
+    if (!recvMembershipList(list, "DIGEST_SYNC")) {
+        return scope.result(false);
+    }
+    if (msg.get<DigestSyncWire::Reply>()) {
+        Address senderAddr(msg.get<DigestSyncWire::From>());
+        sendDigestSync(&senderAddr, msg.get<DigestSyncWire::Buckets>(), false);
+    }
+    return scope.result(true);
 }
 
 /**
@@ -563,65 +972,1241 @@ bool MP1Node::recvMembershipList(void *env, char *data, int size, const char * l
  * (GOSSIP PROTOCOL).
  */
 void MP1Node::nodeLoopOps() {
-    cout << "start nodeLoopOps..." << endl;
+    TraceScope<TRACE_GOSSIP> scope(trace, "nodeLoopOps");
+
+    if (par->PROTOCOL == SWIM_PROTOCOL) {
+        swimLoopOps();
+        return;
+    }
+    if (par->PROTOCOL == HYPARVIEW_PROTOCOL) {
+        hvLoopOps();
+        return;
+    }
+
+    expireMembers();
 
     //completess and accuracy tests fail when this executed of par->getcurrtime() <= 3
     if (par->getcurrtime() > 3 && memberNode->memberList.size() > 1) {
 
-        //update own node's heartbeat and timestamp
-        int id = getIdFromAddress(memberNode->addr.getAddress());
-        short port = getPortFromAddress(memberNode->addr.getAddress());
-        for (vector<MemberListEntry>::iterator entry = memberNode->memberList.begin();
-             entry != memberNode->memberList.end(); entry++) {
-            if (entry->id == id && entry->port == port) {
-                entry->settimestamp(par->getcurrtime());
-                entry->heartbeat = entry->heartbeat + 1;
-                break;
+        //update own node's heartbeat and timestamp. Members beat on the same ticks, so
+        //between epochs their tables settle and the deltas run dry
+        MemberListEntry *self = memberNode->findMember(NodeId(memberNode->addr));
+        if (self) {
+            self->settimestamp(par->getcurrtime());
+            if (par->getcurrtime() % par->HEARTBEAT_EPOCH == 0) {
+                memberNode->setHeartbeat(self, self->heartbeat + 1);
             }
         }
 
         //GOSSIP PROTOCOL: pick a random member to send the member list to
-        int randomIndex = rand() % (memberNode->memberList.size() - 1) + 1;
+        int randomIndex = rng.below(memberNode->memberList.size() - 1) + 1;
         MemberListEntry &entry = memberNode->memberList[randomIndex];
 
-        //check if that node has failed before sending member list to it
-        if (par->getcurrtime() - entry.timestamp > TFAIL) {
+        //check if that node has failed before sending member list to it. With SUSPICION it
+        //is still sent one until removed, or a member cut off by everyone could never refute
+        if (!par->SUSPICION && par->getcurrtime() - entry.timestamp > failAfter(entry)) {
             return;
         }
 
         //send member list
-        Address toAddr;
-        memcpy(&toAddr.addr[0], &entry.id, sizeof(int));
-        memcpy(&toAddr.addr[4], &entry.port, sizeof(short));
+        Address toAddr(entry.getnodeid());
         this->sendMembershipList(&toAddr, HEARTBEATREQ);
     }
 
-    cout << "...end nodeLoopOps." << endl;
     return;
 }
 
 /**
- * FUNCTION NAME: isNullAddress
+ * FUNCTION NAME: scheduleExpiry
  *
- * DESCRIPTION: Function checks if the address is NULL
+ * DESCRIPTION: Set the member's timer for the next tick its timestamp could make a
+ * difference: when it passes failAfter and stops being gossiped, with SUSPICION when it
+ * passes suspectAfter and is suspected, and when it passes removeAfter and is removed.
+ * Fresher timestamps do not move the timer; it finds out when it fires and schedules
+ * itself again.
  */
-int MP1Node::isNullAddress(Address *addr) {
-    return (memcmp(addr->addr, NULLADDR, 6) == 0 ? 1 : 0);
+void MP1Node::scheduleExpiry(MemberListEntry &entry) {
+    int elapsed = par->getcurrtime() - entry.timestamp;
+    int fail = failAfter(entry);
+    if (elapsed <= fail) {
+        expiry.schedule(entry.timestamp + fail + 1, entry.getnodeid());
+    }
+    else if (par->SUSPICION && entry.state == MEMBER_ALIVE && elapsed <= suspectAfter(entry)) {
+        expiry.schedule(entry.timestamp + suspectAfter(entry) + 1, entry.getnodeid());
+    }
+    else {
+        expiry.schedule(entry.timestamp + removeAfter(entry) + 1, entry.getnodeid());
+    }
 }
 
 /**
- * FUNCTION NAME: getJoinAddress
+ * FUNCTION NAME: failAfter
  *
- * DESCRIPTION: Returns the Address of the coordinator
+ * DESCRIPTION: Ticks of silence after which the member counts as failed: TFAIL, or with
+ * FAILURE_DETECTOR: PHI as many as its own heartbeat history makes unremarkable. A member
+ * beating only every HEARTBEAT_EPOCH ticks gets two epochs more, so that one heartbeat
+ * spreading slowly is not taken for a failure.
  */
-Address MP1Node::getJoinAddress() {
-    Address joinaddr;
+int MP1Node::failAfter(MemberListEntry &entry) {
+    if (par->FAILURE_DETECTOR == PHI_DETECTOR) {
+        return entry.arrivals.suspectAfter(par->PHI_THRESHOLD, TFAIL, TREMOVE);
+    }
+    return TFAIL + 2 * (par->HEARTBEAT_EPOCH - 1);
+}
+
+/**
+ * FUNCTION NAME: removeAfter
+ *
+ * DESCRIPTION: Ticks of silence after which the member is removed. TREMOVE leaves peers
+ * TREMOVE - TFAIL ticks to stop gossiping it; with PHI the tombstones already keep it from
+ * coming back, so it only waits PHI_GRACE ticks for heartbeats still on their way.
+ */
+int MP1Node::removeAfter(MemberListEntry &entry) {
+    if (par->FAILURE_DETECTOR == PHI_DETECTOR) {
+        return failAfter(entry) + PHI_GRACE;
+    }
+    return TREMOVE + 2 * (par->HEARTBEAT_EPOCH - 1);
+}
+
+/**
+ * FUNCTION NAME: suspectAfter
+ *
+ * DESCRIPTION: Ticks of silence after which, with SUSPICION, the member is suspected:
+ * halfway from failAfter to removeAfter. Silences past failAfter are common enough that
+ * suspecting every one of them costs more in rumors and refutations than it saves; halfway
+ * still leaves the member time to refute before it is removed.
+ */
+int MP1Node::suspectAfter(MemberListEntry &entry) {
+    int fail = failAfter(entry);
+    return fail + (removeAfter(entry) - fail) / 2;
+}
 
-    memset(&joinaddr, 0, sizeof(Address));
-    *(int *)(&joinaddr.addr) = 1;
-    *(short *)(&joinaddr.addr[4]) = 0;
+/**
+ * FUNCTION NAME: heartbeatArrived
+ *
+ * DESCRIPTION: Timestamp a fresh heartbeat of the member, recording the gap since the last
+ */
+void MP1Node::heartbeatArrived(MemberListEntry *entry) {
+    //several lists that tick may have carried newer heartbeats; it is one arrival
+    if (par->getcurrtime() > entry->timestamp) {
+        entry->arrivals.arrival(par->getcurrtime() - entry->timestamp);
+    }
+    entry->settimestamp(par->getcurrtime());
+}
+
+/**
+ * FUNCTION NAME: expireMembers
+ *
+ * DESCRIPTION: Fire the timers due by now, suspect the members silent for longer than
+ * failAfter, remove those silent for longer than removeAfter and forget the tombstones
+ * of those removed 2 * TREMOVE ago
+ */
+void MP1Node::expireMembers() {
+    int now = par->getcurrtime();
+    expiry.advance(now + 1, [this, now](const NodeId &node) {
+        MemberListEntry *entry = memberNode->findMember(node);
+        if (!entry) {
+            //the timer of a tombstone
+            auto tomb = removed.find(node);
+            if (tomb != removed.end() && tomb->second.until <= now) {
+                removed.erase(tomb);
+            }
+            return;
+        }
+        if (now - entry->timestamp <= removeAfter(*entry)) {
+            if (par->SUSPICION && now - entry->timestamp > suspectAfter(*entry)) {
+                suspectMember(entry);
+            }
+            scheduleExpiry(*entry);
+            return;
+        }
+        if (par->SUSPICION) {
+            addRumor(node, MEMBER_DEAD, entry->incarnation);
+        }
+        removeMember(entry);
+    });
+}
+
+/**
+ * FUNCTION NAME: suspectMember
+ *
+ * DESCRIPTION: This node has not heard from the member for suspectAfter ticks. Unless the
+ * group already suspects this incarnation, say so, giving the member the chance to refute
+ * it before it is removed.
+ */
+void MP1Node::suspectMember(MemberListEntry *entry) {
+    if (entry->state != MEMBER_ALIVE) {
+        return;
+    }
+    entry->state = MEMBER_SUSPECT;
+    addRumor(entry->getnodeid(), MEMBER_SUSPECT, entry->incarnation);
+}
 
-    return joinaddr;
+/**
+ * FUNCTION NAME: removeMember
+ *
+ * DESCRIPTION: Take a member out of the table, leaving a tombstone
+ */
+void MP1Node::removeMember(MemberListEntry *entry) {
+    NodeId node = entry->getnodeid();
+#ifdef DEBUGLOG
+    Address logAddr(node);
+    log->logNodeRemove(&memberNode->addr, &logAddr);
+#endif
+    Tombstone tomb = { entry->heartbeat, par->getcurrtime() + 2 * TREMOVE };
+    removed[node] = tomb;
+    expiry.schedule(tomb.until, node);
+    memberNode->eraseMember(entry - &memberNode->memberList[0]);
+}
+
+/**
+ * FUNCTION NAME: addRumor
+ *
+ * DESCRIPTION: Queue a member's new state for piggybacking, replacing older news about it
+ */
+void MP1Node::addRumor(NodeId node, memberState state, long incarnation) {
+    for (size_t i = 0; i < rumors.size(); i++) {
+        if (rumors[i].node == node) {
+            rumors.erase(rumors.begin() + i);
+            break;
+        }
+    }
+    Rumor rumor;
+    rumor.node = node;
+    rumor.state = state;
+    rumor.incarnation = incarnation;
+    rumor.sends = 0;
+    rumors.push_back(rumor);
+    rumorsQueued++;
+}
+
+/**
+ * FUNCTION NAME: writeRumors
+ *
+ * DESCRIPTION: Write up to RUMOR_PIGGYBACK rumors at out, newest first, as [count] then
+ * [Address] [memberState] [varint incarnation] each. Like SWIM's updates, a rumor is
+ * dropped once it has been sent RUMOR_LAMBDA * log2(members) times, so the message
+ * written must be sent once, to one receiver.
+ *
+ * RETURNS:
+ * the number of rumors written
+ */
+int MP1Node::writeRumors(WireWriter &out) {
+    if (rumors.empty()) {
+        return 0;
+    }
+    int limit = RUMOR_LAMBDA * (int)ceil(log2(memberNode->memberList.size() + 1));
+    char *countPtr = out.reserve(1);
+    int count = 0;
+
+    for (int i = (int)rumors.size() - 1; i >= 0 && count < RUMOR_PIGGYBACK; i--) {
+        out.put<NodeId>(rumors[i].node);
+        out.put<uint8_t>(rumors[i].state);
+        out.varint(rumors[i].incarnation);
+        rumors[i].sends++;
+        count++;
+    }
+    if (countPtr) {
+        *countPtr = (char)count;
+    }
+
+    for (size_t i = 0; i < rumors.size();) {
+        if (rumors[i].sends >= limit) {
+            rumors.erase(rumors.begin() + i);
+        }
+        else {
+            ++i;
+        }
+    }
+    return count;
+}
+
+/**
+ * FUNCTION NAME: readRumors
+ *
+ * DESCRIPTION: Apply the rumors written by writeRumors at in and pass on the ones
+ * that were news. A suspicion or removal of this node is refuted with a new incarnation.
+ * A removal is only taken on by a node that has itself stopped hearing from the member,
+ * so one node's mistake does not remove a member everywhere.
+ *
+ * RETURNS:
+ * false if they run past the end of the message
+ */
+bool MP1Node::readRumors(WireReader &in) {
+    int count = in.get<uint8_t>();
+
+    NodeId self(memberNode->addr);
+    for (int i = 0; i < count; i++) {
+        NodeId node = in.get<NodeId>();
+        memberState state = (memberState)in.get<uint8_t>();
+        long incarnation = (long)in.varint();
+        if (!in.ok()) {
+            return false;
+        }
+
+        MemberListEntry *entry = memberNode->findMember(node);
+        if (!entry || incarnation < entry->incarnation) {
+            continue;
+        }
+
+        if (node == self) {
+            if (state != MEMBER_ALIVE) {
+                entry->incarnation = incarnation + 1;
+                memberNode->touchMember(entry);
+                addRumor(node, MEMBER_ALIVE, entry->incarnation);
+                trace.event<TRACE_INFO, TRACE_MEMBERS>("refuted suspicion, incarnation", entry->incarnation);
+            }
+            continue;
+        }
+
+        if (state == MEMBER_ALIVE) {
+            if (incarnation > entry->incarnation) {
+                entry->incarnation = incarnation;
+                entry->state = MEMBER_ALIVE;
+                entry->settimestamp(max(entry->timestamp, (long)par->getcurrtime()));
+                memberNode->touchMember(entry);
+                addRumor(node, MEMBER_ALIVE, entry->incarnation);
+            }
+        }
+        else if (state == MEMBER_SUSPECT) {
+            if (incarnation > entry->incarnation || entry->state == MEMBER_ALIVE) {
+                entry->incarnation = incarnation;
+                entry->state = MEMBER_SUSPECT;
+                addRumor(node, MEMBER_SUSPECT, entry->incarnation);
+            }
+        }
+        else if (par->getcurrtime() - entry->timestamp > failAfter(*entry)) {
+            addRumor(node, MEMBER_DEAD, incarnation);
+            removeMember(entry);
+        }
+    }
+    return in.ok();
+}
+
+/**
+ * FUNCTION NAME: swimLoopOps
+ *
+ * DESCRIPTION: One tick of the SWIM failure detector. Every SWIM_PERIOD ticks a new member
+ * is probed with a PING. Without an ACK after SWIM_TIMEOUT ticks, SWIM_K other members are
+ * asked to PING it too; without any ACK by the end of the period it is suspected, and
+ * unless it refutes that within SWIM_SUSPECT ticks it is declared failed. Joins,
+ * suspicions, refutations and failures spread piggybacked on these messages.
+ */
+void MP1Node::swimLoopOps() {
+    int now = par->getcurrtime();
+
+    expireSuspects();
+
+    if (probing) {
+        if (!probeAcked && now - probeStart == par->SWIM_TIMEOUT) {
+            trace.event<TRACE_DEBUG, TRACE_SWIM>("no direct ack, probing indirectly", probeTarget.getid());
+            sendPingReqs();
+        }
+        if (now - probeStart < par->SWIM_PERIOD) {
+            return;
+        }
+        MemberListEntry *probed = memberNode->findMember(probeTarget);
+        if (!probeAcked && probed && probed->state == MEMBER_ALIVE) {
+            trace.event<TRACE_INFO, TRACE_SWIM>("probe unanswered, suspecting", probeTarget.getid());
+            swimSuspect(probed, probed->incarnation);
+        }
+        probing = false;
+    }
+
+    NodeId target;
+    if (!nextProbeTarget(&target)) {
+        return;
+    }
+    probing = true;
+    probeTarget = target;
+    probeSeq++;
+    probeAcked = false;
+    probeStart = now;
+    NodeId self(memberNode->addr);
+
+    //a suspect is told so on the probe itself, and its ACK carries back the refutation
+    MemberListEntry *entry = memberNode->findMember(target);
+    if (entry && entry->state == MEMBER_SUSPECT) {
+        addUpdate(target, SWIM_SUSPECT, entry->incarnation);
+    }
+    sendSwim(PING, target, self, target, probeSeq);
+}
+
+/**
+ * FUNCTION NAME: nextProbeTarget
+ *
+ * DESCRIPTION: Members are probed in rounds, each round in a fresh random order, so every
+ * member is probed once per round whatever the draws.
+ *
+ * RETURNS:
+ * false if there is no one to probe
+ */
+bool MP1Node::nextProbeTarget(NodeId *target) {
+    for (int rounds = 0; rounds < 2; rounds++) {
+        while (probeNext < probeOrder.size()) {
+            NodeId node = probeOrder[probeNext++];
+            if (memberNode->findMember(node)) {
+                *target = node;
+                return true;
+            }
+        }
+
+        //start a new round over everyone but this node, the first entry
+        probeOrder.clear();
+        for (size_t i = 1; i < memberNode->memberList.size(); i++) {
+            probeOrder.push_back(memberNode->memberList[i].getnodeid());
+        }
+        for (int i = (int)probeOrder.size() - 1; i > 0; i--) {
+            swap(probeOrder[i], probeOrder[rng.below(i + 1)]);
+        }
+        probeNext = 0;
+    }
+    return false;
+}
+
+/**
+ * FUNCTION NAME: sendPingReqs
+ *
+ * DESCRIPTION: Ask SWIM_K random members other than the target to probe it for this node
+ */
+void MP1Node::sendPingReqs() {
+    NodeId self(memberNode->addr);
+    int n = (int)memberNode->memberList.size();
+    int helpers = 0;
+
+    //a partial shuffle of positions 1..n-1 picks distinct members
+    vector<int> &pick = pingReqPick;
+    pick.clear();
+    for (int i = 1; i < n; i++) {
+        pick.push_back(i);
+    }
+    for (int i = 0; i < (int)pick.size() && helpers < par->SWIM_K; i++) {
+        swap(pick[i], pick[i + rng.below(pick.size() - i)]);
+        NodeId helper = memberNode->memberList[pick[i]].getnodeid();
+        if (helper == probeTarget) {
+            continue;
+        }
+        sendSwim(PING_REQ, helper, self, probeTarget, probeSeq);
+        helpers++;
+    }
+}
+
+/**
+ * FUNCTION NAME: sendSwim
+ *
+ * DESCRIPTION: Send a PING, PING_REQ or ACK to a member, with as many updates as fit
+ */
+void MP1Node::sendSwim(enum MsgTypes msgType, NodeId to, NodeId origin, NodeId target, uint32_t seq) {
+    char *body = allocMessage(msgType, SWIM_MSG_MAX);
+    WireBuilder<SwimWire> msg(body, SWIM_MSG_MAX);
+    msg.set<SwimWire::From>(NodeId(memberNode->addr));
+    msg.set<SwimWire::Origin>(origin);
+    msg.set<SwimWire::Target>(target);
+    msg.set<SwimWire::Seq>(seq);
+
+    WireWriter out = msg.rest();
+    writeUpdates(out);
+
+    Address toAddr(to);
+    sendMessage(&toAddr, body, SwimWire::SIZE + out.size());
+}
+
+/**
+ * FUNCTION NAME: recvSwim
+ *
+ * DESCRIPTION: Read the updates of a PING, PING_REQ or ACK, and note that
+ * its sender is alive
+ *
+ * RETURNS:
+ * false if the message is malformed
+ */
+bool MP1Node::recvSwim(const WireView<SwimWire> &msg) {
+    if (!msg.valid()) {
+        return false;
+    }
+
+    //the sender may be refuting its own failure
+    WireReader updates = msg.rest();
+    if (!readUpdates(updates)) {
+        return false;
+    }
+    heardFrom(msg.get<SwimWire::From>());
+    return true;
+}
+
+/**
+ * FUNCTION NAME: heardFrom
+ *
+ * DESCRIPTION: A message from a member shows it is up; learn of it if it is new. A member
+ * this node suspects or has declared failed is told so again, as the newest news, so that
+ * whatever this node sends it next makes it refute. A SWIM member's timestamp is when it
+ * was last heard from, or once suspected, when the suspicion started.
+ */
+void MP1Node::heardFrom(NodeId node) {
+    auto dead = deadNodes.find(node);
+    if (dead != deadNodes.end()) {
+        addUpdate(node, SWIM_FAILED, dead->second);
+        return;
+    }
+
+    updateMembershipList(node, 0);
+    MemberListEntry *entry = memberNode->findMember(node);
+    if (!entry) {
+        return;
+    }
+    if (entry->state == MEMBER_SUSPECT) {
+        addUpdate(node, SWIM_SUSPECT, entry->incarnation);
+    }
+    else {
+        entry->settimestamp(par->getcurrtime());
+    }
+}
+
+/**
+ * FUNCTION NAME: expireSuspects
+ *
+ * DESCRIPTION: Declare failed the members suspected SWIM_SUSPECT ticks ago that have not
+ * refuted it since. A timer left over from a suspicion that was refuted and raised again
+ * finds the suspicion too recent and does nothing; the newer one has its own timer.
+ */
+void MP1Node::expireSuspects() {
+    int now = par->getcurrtime();
+    expiry.advance(now + 1, [this, now](const NodeId &node) {
+        MemberListEntry *entry = memberNode->findMember(node);
+        if (entry && entry->state == MEMBER_SUSPECT && now - entry->timestamp >= par->SWIM_SUSPECT) {
+            declareFailed(node, entry->incarnation);
+        }
+    });
+}
+
+/**
+ * FUNCTION NAME: swimSuspect
+ *
+ * DESCRIPTION: Suspect this incarnation of a member, and tell the others so the member
+ * hears of it and can refute it before SWIM_SUSPECT ticks are up
+ */
+void MP1Node::swimSuspect(MemberListEntry *entry, long incarnation) {
+    NodeId node = entry->getnodeid();
+    entry->incarnation = incarnation;
+    entry->state = MEMBER_SUSPECT;
+    entry->settimestamp(par->getcurrtime());
+    expiry.schedule(par->getcurrtime() + par->SWIM_SUSPECT, node);
+    addUpdate(node, SWIM_SUSPECT, incarnation);
+}
+
+/**
+ * FUNCTION NAME: declareFailed
+ *
+ * DESCRIPTION: Remove this incarnation of a member and tell the others. The member stays
+ * out until it refutes the failure with a newer incarnation.
+ */
+void MP1Node::declareFailed(NodeId node, long incarnation) {
+    if (node == NodeId(memberNode->addr)) {
+        return;
+    }
+    auto dead = deadNodes.find(node);
+    if (dead != deadNodes.end() && dead->second >= incarnation) {
+        return;
+    }
+    MemberListEntry *entry = memberNode->findMember(node);
+    if (entry && entry->incarnation > incarnation) {
+        //already refuted
+        return;
+    }
+
+    deadNodes[node] = incarnation;
+    if (entry) {
+#ifdef DEBUGLOG
+        Address logAddr(node);
+        log->logNodeRemove(&memberNode->addr, &logAddr);
+#endif
+        memberNode->eraseMember(entry - &memberNode->memberList[0]);
+    }
+    addUpdate(node, SWIM_FAILED, incarnation);
+}
+
+/**
+ * FUNCTION NAME: refute
+ *
+ * DESCRIPTION: The group suspects this node, or has declared it failed, at incarnation;
+ * answer with a newer one, which overrides both wherever it arrives. News of an older
+ * incarnation is already refuted, but whoever passed it on has not heard, so the
+ * refutation goes out again.
+ */
+void MP1Node::refute(long incarnation) {
+    NodeId self(memberNode->addr);
+    MemberListEntry *entry = memberNode->findMember(self);
+    if (!entry) {
+        return;
+    }
+    if (incarnation >= entry->incarnation) {
+        entry->incarnation = incarnation + 1;
+        memberNode->touchMember(entry);
+        trace.event<TRACE_INFO, TRACE_SWIM>("refuted suspicion, incarnation", entry->incarnation);
+    }
+    addUpdate(self, SWIM_ALIVE, entry->incarnation);
+}
+
+/**
+ * FUNCTION NAME: addUpdate
+ *
+ * DESCRIPTION: Queue news about a member for piggybacking, replacing older news about it
+ */
+void MP1Node::addUpdate(NodeId node, SwimUpdateKind kind, long incarnation) {
+    for (size_t i = 0; i < updates.size(); i++) {
+        if (updates[i].node == node) {
+            updates.erase(updates.begin() + i);
+            break;
+        }
+    }
+    SwimUpdate update;
+    update.node = node;
+    update.kind = kind;
+    update.incarnation = incarnation;
+    update.sends = 0;
+    updates.push_back(update);
+}
+
+/**
+ * FUNCTION NAME: writeUpdates
+ *
+ * DESCRIPTION: Write up to SWIM_PIGGYBACK updates at out, newest first, as
+ * [count] then [Address] [SwimUpdateKind] [varint incarnation] each. An update is dropped
+ * once it has been sent SWIM_LAMBDA * log2(members) times, enough for it to have reached
+ * everyone.
+ */
+void MP1Node::writeUpdates(WireWriter &out) {
+    int limit = SWIM_LAMBDA * (int)ceil(log2(memberNode->memberList.size() + 1));
+    char *countPtr = out.reserve(1);
+    int count = 0;
+
+    for (int i = (int)updates.size() - 1; i >= 0 && count < SWIM_PIGGYBACK; i--) {
+        out.put<NodeId>(updates[i].node);
+        out.put<uint8_t>(updates[i].kind);
+        out.varint(updates[i].incarnation);
+        updates[i].sends++;
+        count++;
+    }
+    if (countPtr) {
+        *countPtr = (char)count;
+    }
+
+    for (size_t i = 0; i < updates.size();) {
+        if (updates[i].sends >= limit) {
+            updates.erase(updates.begin() + i);
+        }
+        else {
+            ++i;
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: readUpdates
+ *
+ * DESCRIPTION: Apply the updates written by writeUpdates at in. News about an older
+ * incarnation than the one known is stale. A suspicion or failure of this node is
+ * refuted; a member declared failed only comes back with a newer incarnation, which
+ * only the member itself hands out.
+ *
+ * RETURNS:
+ * false if they run past the end of the message
+ */
+bool MP1Node::readUpdates(WireReader &in) {
+    //every update takes at least an address, its kind and a one-byte incarnation
+    int count = in.get<uint8_t>();
+    if (!in.ok() || in.left() < count * (WIRE_ADDR_LEN + 2)) {
+        return false;
+    }
+
+    NodeId self(memberNode->addr);
+    for (int i = 0; i < count; i++) {
+        NodeId node = in.get<NodeId>();
+        SwimUpdateKind kind = (SwimUpdateKind)in.get<uint8_t>();
+        long incarnation = (long)in.varint();
+        if (!in.ok()) {
+            return false;
+        }
+
+        if (node == self) {
+            if (kind != SWIM_ALIVE) {
+                refute(incarnation);
+            }
+            continue;
+        }
+        if (kind == SWIM_FAILED) {
+            declareFailed(node, incarnation);
+            continue;
+        }
+
+        auto dead = deadNodes.find(node);
+        if (dead != deadNodes.end()) {
+            if (kind != SWIM_ALIVE || incarnation <= dead->second) {
+                continue;
+            }
+            deadNodes.erase(dead);
+        }
+        updateMembershipList(node, 0);
+        MemberListEntry *entry = memberNode->findMember(node);
+        if (!entry) {
+            continue;
+        }
+
+        if (kind == SWIM_ALIVE) {
+            if (incarnation > entry->incarnation) {
+                entry->incarnation = incarnation;
+                entry->state = MEMBER_ALIVE;
+                entry->settimestamp(par->getcurrtime());
+                memberNode->touchMember(entry);
+                addUpdate(node, SWIM_ALIVE, incarnation);
+            }
+        }
+        else if (incarnation > entry->incarnation || (incarnation == entry->incarnation && entry->state == MEMBER_ALIVE)) {
+            swimSuspect(entry, incarnation);
+        }
+    }
+    return true;
+}
+
+/**
+ * FUNCTION NAME: pingHandler
+ *
+ * DESCRIPTION: Handler for PING messages: ACK to the sender, who passes it on to the origin
+ * if it was probing for someone else
+ */
+bool MP1Node::pingHandler(void *, char *data, int size) {
+    TraceScope<TRACE_SWIM> scope(trace, "pingHandler");
+
+    WireView<SwimWire> msg(data, size);
+    if (!recvSwim(msg)) {
+        return scope.result(false);
+    }
+
+    sendSwim(ACK, msg.get<SwimWire::From>(), msg.get<SwimWire::Origin>(), NodeId(memberNode->addr), msg.get<SwimWire::Seq>());
+    return scope.result(true);
+}
+
+/**
+ * FUNCTION NAME: pingReqHandler
+ *
+ * DESCRIPTION: Handler for PING_REQ messages: PING the target on behalf of the origin
+ */
+bool MP1Node::pingReqHandler(void *, char *data, int size) {
+    TraceScope<TRACE_SWIM> scope(trace, "pingReqHandler");
+
+    WireView<SwimWire> msg(data, size);
+    if (!recvSwim(msg)) {
+        return scope.result(false);
+    }
+
+    NodeId target = msg.get<SwimWire::Target>();
+    sendSwim(PING, target, msg.get<SwimWire::Origin>(), target, msg.get<SwimWire::Seq>());
+    return scope.result(true);
+}
+
+/**
+ * FUNCTION NAME: ackHandler
+ *
+ * DESCRIPTION: Handler for ACK messages: completes this node's probe, or is relayed to the
+ * origin of an indirect one
+ */
+bool MP1Node::ackHandler(void *, char *data, int size) {
+    TraceScope<TRACE_SWIM> scope(trace, "ackHandler");
+
+    WireView<SwimWire> msg(data, size);
+    if (!recvSwim(msg)) {
+        return scope.result(false);
+    }
+
+    NodeId origin = msg.get<SwimWire::Origin>();
+    NodeId target = msg.get<SwimWire::Target>();
+    uint32_t seq = msg.get<SwimWire::Seq>();
+    if (origin != NodeId(memberNode->addr)) {
+        sendSwim(ACK, origin, origin, target, seq);
+        return scope.result(true);
+    }
+    if (probing && target == probeTarget && seq == probeSeq) {
+        probeAcked = true;
+    }
+    return scope.result(true);
+}
+
+/**
+ * FUNCTION NAME: hvLoopOps
+ *
+ * DESCRIPTION: One tick of HyParView. Neighbors silent for TFAIL ticks have failed and are
+ * dropped; a short active view is refilled from the passive view one NEIGHBOR request at a
+ * time; neighbors get a KEEPALIVE every HV_KEEPALIVE ticks, and every SHUFFLE_PERIOD ticks
+ * a sample of both views goes on a random walk to refresh some other node's passive view.
+ * A node short of neighbors whose passive view has run dry joins again.
+ */
+void MP1Node::hvLoopOps() {
+    int now = par->getcurrtime();
+    NodeId self(memberNode->addr);
+
+    for (int i = (int)activeView.size() - 1; i >= 0; i--) {
+        if (now - activeView[i].heard > TFAIL) {
+            trace.event<TRACE_INFO, TRACE_HYPARVIEW>("neighbor silent, dropping", activeView[i].node.getid());
+            hvRemoveActive(i, true);
+        }
+    }
+
+    //a passive member that does not answer is gone too
+    if (neighborPending && now - neighborSince > TFAIL) {
+        hvRemovePassive(neighborTarget);
+        neighborPending = false;
+    }
+    if (!neighborPending && (int)activeView.size() < par->ACTIVE_VIEW && !passiveView.empty()) {
+        neighborTarget = passiveView[rng.below(passiveView.size())];
+        neighborPending = true;
+        neighborSince = now;
+        hvSend(NEIGHBOR, neighborTarget, self, 0, activeView.empty(), NULL);
+    }
+
+    if (now % HV_KEEPALIVE == 0) {
+        for (size_t i = 0; i < activeView.size(); i++) {
+            hvSend(KEEPALIVE, activeView[i].node, self, 0, 0, NULL);
+        }
+    }
+
+    //nodes shuffle at different ticks, spread by id
+    if ((now + self.getid()) % par->SHUFFLE_PERIOD != 0) {
+        return;
+    }
+
+    //short of neighbors with no one left to ask: join again, as a node the introducer
+    //dropped straight after its join can be
+    Address joinaddr = getJoinAddress();
+    if ((int)activeView.size() < par->ACTIVE_VIEW && passiveView.empty() && NodeId(joinaddr) != self) {
+        introduceSelfToGroup(&joinaddr);
+    }
+
+    if (!activeView.empty()) {
+        vector<NodeId> active;
+        for (size_t i = 0; i < activeView.size(); i++) {
+            active.push_back(activeView[i].node);
+        }
+        hvList.clear();
+        hvList.push_back(self);
+        hvSample(active, HV_SHUFFLE_KA, hvList);
+        hvSample(passiveView, HV_SHUFFLE_KP, hvList);
+        hvSend(SHUFFLE, activeView[rng.below(activeView.size())].node, self, HV_ARWL, 0, &hvList);
+    }
+}
+
+/**
+ * FUNCTION NAME: hvJoin
+ *
+ * DESCRIPTION: The introducer's part of a JOINREQ: take the new node as a neighbor and send
+ * it on ACTIVE_VIEW - 1 random walks. Every join comes through here, so the introducer's own
+ * neighbors are always the latest joiners, and walks from them would link nodes mostly to
+ * others that joined about the same time; a cluster of such nodes failing together would
+ * split the overlay. The walks start instead from a reservoir sample of all earlier joiners.
+ */
+void MP1Node::hvJoin(NodeId node) {
+    NodeId self(memberNode->addr);
+    hvAddActive(node);
+    hvSend(NEIGHBOR_REP, node, self, 0, 1, NULL);
+
+    if (!joinSample.empty()) {
+        hvList.clear();
+        hvSample(joinSample, par->ACTIVE_VIEW - 1, hvList);
+        for (size_t i = 0; i < hvList.size(); i++) {
+            hvSend(FORWARD_JOIN, hvList[i], node, HV_ARWL, 0, NULL);
+        }
+    }
+
+    //Algorithm R: the node replaces a random entry with probability size / joinsSeen
+    joinsSeen++;
+    if ((int)joinSample.size() < par->PASSIVE_VIEW) {
+        joinSample.push_back(node);
+    }
+    else {
+        int pos = rng.below(joinsSeen);
+        if (pos < (int)joinSample.size()) {
+            joinSample[pos] = node;
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: hvFindActive
+ *
+ * DESCRIPTION: Position of node in the active view, or -1
+ */
+int MP1Node::hvFindActive(NodeId node) {
+    for (size_t i = 0; i < activeView.size(); i++) {
+        if (activeView[i].node == node) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * FUNCTION NAME: hvAddActive
+ *
+ * DESCRIPTION: Make node a neighbor, disconnecting a random one if the view is full
+ */
+void MP1Node::hvAddActive(NodeId node) {
+    if (node == NodeId(memberNode->addr) || hvFindActive(node) >= 0) {
+        return;
+    }
+    hvRemovePassive(node);
+    if ((int)activeView.size() >= par->ACTIVE_VIEW) {
+        int victim = rng.below(activeView.size());
+        hvSend(DISCONNECT, activeView[victim].node, NodeId(memberNode->addr), 0, 0, NULL);
+        hvRemoveActive(victim, false);
+    }
+
+    HvPeer peer;
+    peer.node = node;
+    peer.heard = par->getcurrtime();
+    activeView.push_back(peer);
+#ifdef DEBUGLOG
+    Address logAddr(node);
+    log->logNodeAdd(&memberNode->addr, &logAddr);
+#endif
+}
+
+/**
+ * FUNCTION NAME: hvRemoveActive
+ *
+ * DESCRIPTION: Drop the neighbor at pos. One that merely disconnected is kept in the
+ * passive view; a failed one is forgotten.
+ */
+void MP1Node::hvRemoveActive(int pos, bool failed) {
+    NodeId node = activeView[pos].node;
+    activeView[pos] = activeView.back();
+    activeView.pop_back();
+#ifdef DEBUGLOG
+    Address logAddr(node);
+    log->logNodeRemove(&memberNode->addr, &logAddr);
+#endif
+    if (!failed) {
+        hvAddPassive(node);
+    }
+}
+
+/**
+ * FUNCTION NAME: hvAddPassive
+ *
+ * DESCRIPTION: Remember node in the passive view, evicting a random entry if it is full
+ */
+void MP1Node::hvAddPassive(NodeId node) {
+    if (node == NodeId(memberNode->addr) || hvFindActive(node) >= 0
+            || find(passiveView.begin(), passiveView.end(), node) != passiveView.end()) {
+        return;
+    }
+    if ((int)passiveView.size() >= par->PASSIVE_VIEW) {
+        passiveView[rng.below(passiveView.size())] = node;
+        return;
+    }
+    passiveView.push_back(node);
+}
+
+/**
+ * FUNCTION NAME: hvRemovePassive
+ *
+ * DESCRIPTION: Forget node from the passive view
+ */
+void MP1Node::hvRemovePassive(NodeId node) {
+    vector<NodeId>::iterator it = find(passiveView.begin(), passiveView.end(), node);
+    if (it != passiveView.end()) {
+        *it = passiveView.back();
+        passiveView.pop_back();
+    }
+}
+
+/**
+ * FUNCTION NAME: hvSample
+ *
+ * DESCRIPTION: Append up to count distinct random members of from to out
+ */
+void MP1Node::hvSample(const vector<NodeId> &from, int count, vector<NodeId> &out) {
+    int n = (int)from.size();
+    if (count >= n) {
+        out.insert(out.end(), from.begin(), from.end());
+        return;
+    }
+    //Floyd's algorithm: count distinct positions without copying from
+    size_t first = out.size();
+    for (int j = n - count; j < n; j++) {
+        NodeId pick = from[rng.below(j + 1)];
+        if (find(out.begin() + first, out.end(), pick) != out.end()) {
+            pick = from[j];
+        }
+        out.push_back(pick);
+    }
+}
+
+/**
+ * FUNCTION NAME: hvSend
+ *
+ * DESCRIPTION: Send a HyParView message, with the addresses of list after the HvWire
+ */
+void MP1Node::hvSend(enum MsgTypes msgType, NodeId to, NodeId node, int ttl, int flag, const vector<NodeId> *list) {
+    int count = list ? min((int)list->size(), (int)UCHAR_MAX) : 0;
+    int size = HvWire::SIZE + count * WIRE_ADDR_LEN;
+    char *body = allocMessage(msgType, size);
+    WireBuilder<HvWire> msg(body, size);
+    msg.set<HvWire::From>(NodeId(memberNode->addr));
+    msg.set<HvWire::Node>(node);
+    msg.set<HvWire::Ttl>((uint8_t)ttl);
+    msg.set<HvWire::Flag>((uint8_t)flag);
+    msg.set<HvWire::Count>((uint8_t)count);
+
+    WireWriter out = msg.rest();
+    for (int i = 0; i < count; i++) {
+        out.put<NodeId>((*list)[i]);
+    }
+
+    Address toAddr(to);
+    sendMessage(&toAddr, body, size);
+}
+
+/**
+ * FUNCTION NAME: hvRecv
+ *
+ * DESCRIPTION: Read the addresses after the HvWire, if any, and note that a neighbor that
+ * sent it is alive
+ *
+ * RETURNS:
+ * false if the message is malformed
+ */
+bool MP1Node::hvRecv(const WireView<HvWire> &msg, vector<NodeId> *list) {
+    if (!msg.valid()) {
+        return false;
+    }
+    int count = msg.get<HvWire::Count>();
+    WireReader in = msg.rest();
+    if (in.left() < count * WIRE_ADDR_LEN) {
+        return false;
+    }
+
+    if (list) {
+        list->clear();
+        for (int i = 0; i < count; i++) {
+            list->push_back(in.get<NodeId>());
+        }
+    }
+
+    int pos = hvFindActive(msg.get<HvWire::From>());
+    if (pos >= 0) {
+        activeView[pos].heard = par->getcurrtime();
+    }
+    return true;
+}
+
+/**
+ * FUNCTION NAME: forwardJoinHandler
+ *
+ * DESCRIPTION: Handler for FORWARD_JOIN messages. The walk ends here when its hops run
+ * out or this node has no one else to pass it to, and the joining node becomes a neighbor;
+ * at hop HV_PRWL it is also remembered in the passive view.
+ */
+bool MP1Node::forwardJoinHandler(void *, char *data, int size) {
+    TraceScope<TRACE_HYPARVIEW> scope(trace, "forwardJoinHandler");
+
+    WireView<HvWire> msg(data, size);
+    if (!hvRecv(msg, NULL)) {
+        return scope.result(false);
+    }
+
+    NodeId from = msg.get<HvWire::From>();
+    NodeId node = msg.get<HvWire::Node>();
+    int ttl = msg.get<HvWire::Ttl>();
+    if (node == NodeId(memberNode->addr)) {
+        return scope.result(true);
+    }
+
+    if (ttl == 0 || activeView.size() <= 1) {
+        hvAddActive(node);
+        hvSend(NEIGHBOR, node, NodeId(memberNode->addr), 0, 1, NULL);
+        return scope.result(true);
+    }
+    if (ttl == HV_PRWL) {
+        hvAddPassive(node);
+    }
+
+    //pass it on to a neighbor other than the one it came from
+    int pos = rng.below(activeView.size());
+    if (activeView[pos].node == from) {
+        pos = (pos + 1) % activeView.size();
+    }
+    hvSend(FORWARD_JOIN, activeView[pos].node, node, ttl - 1, 0, NULL);
+    return scope.result(true);
+}
+
+/**
+ * FUNCTION NAME: neighborHandler
+ *
+ * DESCRIPTION: Handler for NEIGHBOR messages: accept the sender as a neighbor if there is
+ * room, or anyway if it has no neighbors left, and say which
+ */
+bool MP1Node::neighborHandler(void *, char *data, int size) {
+    TraceScope<TRACE_HYPARVIEW> scope(trace, "neighborHandler");
+
+    WireView<HvWire> msg(data, size);
+    if (!hvRecv(msg, NULL)) {
+        return scope.result(false);
+    }
+
+    NodeId from = msg.get<HvWire::From>();
+    bool accept = msg.get<HvWire::Flag>() || (int)activeView.size() < par->ACTIVE_VIEW;
+    if (accept) {
+        hvAddActive(from);
+    }
+    hvSend(NEIGHBOR_REP, from, NodeId(memberNode->addr), 0, accept, NULL);
+    return scope.result(true);
+}
+
+/**
+ * FUNCTION NAME: neighborRepHandler
+ *
+ * DESCRIPTION: Handler for NEIGHBOR_REP messages. The first acceptance, usually the
+ * introducer's, puts this node in the group.
+ */
+bool MP1Node::neighborRepHandler(void *, char *data, int size) {
+    TraceScope<TRACE_HYPARVIEW> scope(trace, "neighborRepHandler");
+
+    WireView<HvWire> msg(data, size);
+    if (!hvRecv(msg, NULL)) {
+        return scope.result(false);
+    }
+
+    NodeId node = msg.get<HvWire::From>();
+    if (neighborPending && node == neighborTarget) {
+        neighborPending = false;
+    }
+    if (msg.get<HvWire::Flag>()) {
+        hvAddActive(node);
+        joinedGroup();
+    }
+    else {
+        //its view is full; ask someone else next time
+        hvRemovePassive(node);
+    }
+    return scope.result(true);
+}
+
+/**
+ * FUNCTION NAME: disconnectHandler
+ *
+ * DESCRIPTION: Handler for DISCONNECT messages: the sender has dropped this node, so this
+ * node moves it to its passive view
+ */
+bool MP1Node::disconnectHandler(void *, char *data, int size) {
+    TraceScope<TRACE_HYPARVIEW> scope(trace, "disconnectHandler");
+
+    WireView<HvWire> msg(data, size);
+    if (!hvRecv(msg, NULL)) {
+        return scope.result(false);
+    }
+
+    int pos = hvFindActive(msg.get<HvWire::From>());
+    if (pos >= 0) {
+        hvRemoveActive(pos, false);
+    }
+    return scope.result(true);
+}
+
+/**
+ * FUNCTION NAME: shuffleHandler
+ *
+ * DESCRIPTION: Handler for SHUFFLE messages. The walk goes on while it has hops left and
+ * somewhere to go; where it ends, the origin is sent as many passive members as it sent,
+ * and the ones it sent join this node's passive view.
+ */
+bool MP1Node::shuffleHandler(void *, char *data, int size) {
+    TraceScope<TRACE_HYPARVIEW> scope(trace, "shuffleHandler");
+
+    WireView<HvWire> msg(data, size);
+    vector<NodeId> received;
+    if (!hvRecv(msg, &received)) {
+        return scope.result(false);
+    }
+
+    NodeId from = msg.get<HvWire::From>();
+    NodeId origin = msg.get<HvWire::Node>();
+    int ttl = msg.get<HvWire::Ttl>();
+    if (ttl > 0 && activeView.size() > 1) {
+        int pos = rng.below(activeView.size());
+        if (activeView[pos].node == from) {
+            pos = (pos + 1) % activeView.size();
+        }
+        hvSend(SHUFFLE, activeView[pos].node, origin, ttl - 1, 0, &received);
+        return scope.result(true);
+    }
+
+    if (origin != NodeId(memberNode->addr)) {
+        hvList.clear();
+        hvSample(passiveView, (int)received.size(), hvList);
+        hvSend(SHUFFLE_REP, origin, NodeId(memberNode->addr), 0, 0, &hvList);
+    }
+    for (size_t i = 0; i < received.size(); i++) {
+        hvAddPassive(received[i]);
+    }
+    return scope.result(true);
+}
+
+/**
+ * FUNCTION NAME: shuffleRepHandler
+ *
+ * DESCRIPTION: Handler for SHUFFLE_REP messages: add what came back to the passive view
+ */
+bool MP1Node::shuffleRepHandler(void *, char *data, int size) {
+    TraceScope<TRACE_HYPARVIEW> scope(trace, "shuffleRepHandler");
+
+    WireView<HvWire> msg(data, size);
+    vector<NodeId> received;
+    if (!hvRecv(msg, &received)) {
+        return scope.result(false);
+    }
+
+    for (size_t i = 0; i < received.size(); i++) {
+        hvAddPassive(received[i]);
+    }
+    return scope.result(true);
+}
+
+/**
+ * FUNCTION NAME: keepAliveHandler
+ *
+ * DESCRIPTION: Handler for KEEPALIVE messages. hvRecv has already marked the neighbor as
+ * heard from; a sender this node does not count as a neighbor is told to drop it too.
+ */
+bool MP1Node::keepAliveHandler(void *, char *data, int size) {
+    TraceScope<TRACE_HYPARVIEW> scope(trace, "keepAliveHandler");
+
+    WireView<HvWire> msg(data, size);
+    if (!hvRecv(msg, NULL)) {
+        return scope.result(false);
+    }
+
+    NodeId from = msg.get<HvWire::From>();
+    if (hvFindActive(from) < 0) {
+        hvSend(DISCONNECT, from, NodeId(memberNode->addr), 0, 0, NULL);
+    }
+    return scope.result(true);
+}
+
+/**
+ * FUNCTION NAME: isNullAddress
+ *
+ * DESCRIPTION: Function checks if the address is NULL
+ */
+int MP1Node::isNullAddress(Address *addr) {
+    return (memcmp(addr->addr, NULLADDR, 6) == 0 ? 1 : 0);
+}
+
+/**
+ * FUNCTION NAME: getJoinAddress
+ *
+ * DESCRIPTION: Returns the Address of the coordinator
+ */
+Address MP1Node::getJoinAddress() {
+    return Address(NodeId(1, 0));
 }
 
 /**
@@ -630,14 +2215,13 @@ Address MP1Node::getJoinAddress() {
  * DESCRIPTION: Initialize the membership list
  */
 void MP1Node::initMemberListTable(Member *memberNode) {
-    memberNode->memberList.clear();
+    memberNode->clearMembers();
 
     //The very first entry will be the own node
     int id = *(int*)(&memberNode->addr.addr);
     int port = *(short*)(&memberNode->addr.addr[4]);
     MemberListEntry memberEntry(id, port, 0, par->getcurrtime());
-    memberNode->memberList.push_back(memberEntry);
-    memberNode->myPos = memberNode->memberList.begin();
+    memberNode->addMember(memberEntry);
 }
 
 /**
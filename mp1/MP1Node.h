@@ -18,13 +18,64 @@
 #include "Params.h"
 #include "Member.h"
 #include "EmulNet.h"
+#include "Transport.h"
+#include "Random.h"
 #include "Queue.h"
+#include "Varint.h"
+#include "Wire.h"
+#include "TimingWheel.h"
+#include "Trace.h"
+#include <unordered_map>
 
 /**
  * Macros
  */
 #define TREMOVE 20
 #define TFAIL 5
+// with FAILURE_DETECTOR: PHI, ticks a member stays failed before it is removed
+#define PHI_GRACE 6
+// format of the membership lists this node sends; bump it when the encoding changes
+#define LIST_VERSION 2
+// most bytes one encoded list entry takes: id, port, heartbeat and incarnation varints
+#define LIST_ENTRY_MAX (4 * VARINT_MAX_LEN)
+// most bytes a list of n entries takes: LIST_VERSION, the count and the entries
+#define LIST_MAX(n) (1 + VARINT_MAX_LEN + (n) * LIST_ENTRY_MAX)
+// most membership updates piggybacked on one SWIM message
+#define SWIM_PIGGYBACK 8
+// each update is piggybacked SWIM_LAMBDA * log2(members) times
+#define SWIM_LAMBDA 3
+// most bytes one update takes: address, SwimUpdateKind and incarnation varint
+#define SWIM_UPDATE_MAX (WIRE_ADDR_LEN + 1 + VARINT_MAX_LEN)
+// most bytes a PING, PING_REQ or ACK body takes: the SwimWire and a count byte, then
+// the updates
+#define SWIM_MSG_MAX (SwimWire::SIZE + 1 + SWIM_PIGGYBACK * SWIM_UPDATE_MAX)
+// most suspicions, refutations and removals piggybacked on one heartbeat message
+#define RUMOR_PIGGYBACK 8
+// each is piggybacked RUMOR_LAMBDA * log2(members) times
+#define RUMOR_LAMBDA 3
+// most bytes one rumor takes: address, memberState and incarnation varint
+#define RUMOR_MAX (WIRE_ADDR_LEN + 1 + VARINT_MAX_LEN)
+// most bytes the rumors on one message take, count byte included
+#define RUMORS_MAX (1 + RUMOR_PIGGYBACK * RUMOR_MAX)
+// most bytes a HEARTBEATREP body takes
+#define HEARTBEATREP_MAX (FromWire::SIZE + RUMORS_MAX)
+// version of the message formats this node sends; a type's handler is registered per version
+#define MSG_VERSION 1
+// versions a message type can have handlers for at once
+#define MSG_VERSIONS 4
+// message types the dispatch table has room for; the type is one byte on the wire
+#define MSG_TYPES 256
+// largest body MessageHdr's length can describe
+#define MSG_BODY_MAX (USHRT_MAX - (int)sizeof(MessageHdr))
+// HyParView random walks: hops a FORWARD_JOIN or SHUFFLE takes, and the hop at which a
+// FORWARD_JOIN also leaves the joining node in the passive view
+#define HV_ARWL 6
+#define HV_PRWL 3
+// active and passive members a SHUFFLE carries besides its origin
+#define HV_SHUFFLE_KA 3
+#define HV_SHUFFLE_KP 4
+// ticks between KEEPALIVEs to the active view; a neighbor silent for TFAIL has failed
+#define HV_KEEPALIVE 2
 
 /*
  * Note: You can change/add any functions in MP1Node.{h,cpp}
@@ -38,18 +89,126 @@ enum MsgTypes{
     JOINREP,
     HEARTBEATREQ,
     HEARTBEATREP,
+    PING,
+    PING_REQ,
+    ACK,
+    FORWARD_JOIN,
+    NEIGHBOR,
+    NEIGHBOR_REP,
+    DISCONNECT,
+    SHUFFLE,
+    SHUFFLE_REP,
+    KEEPALIVE,
+    DIGEST,
+    DIGEST_REP,
+    DIGEST_SYNC,
     DUMMYLASTMSGTYPE
 };
 
 /**
  * STRUCT NAME: MessageHdr
  *
- * DESCRIPTION: Header and content of a message
+ * DESCRIPTION: Header of a message: its MsgTypes, the version of that type's format, and
+ * the length of the whole message, header included
  */
 typedef struct MessageHdr {
-    enum MsgTypes msgType;
+    uint8_t msgType;
+    uint8_t version;
+    uint16_t length;
 }MessageHdr;
 
+// why recvCallBack dropped a message without handling it
+enum RejectReason {
+    // shorter than a MessageHdr, or than its length says
+    REJECT_TRUNCATED,
+    // no handler for its type and version
+    REJECT_UNKNOWN,
+    // body outside the sizes its handler was registered for
+    REJECT_SIZE,
+    REJECT_REASONS
+};
+
+class MP1Node;
+typedef bool (MP1Node::*MsgHandler)(void *env, char *data, int size);
+
+/**
+ * STRUCT NAME: MsgRoute
+ *
+ * DESCRIPTION: Entry of the dispatch table: the handler for one type and version, and the
+ * smallest and largest body it takes
+ */
+typedef struct MsgRoute {
+    MsgHandler handler;
+    int minSize;
+    int maxSize;
+}MsgRoute;
+
+/**
+ * STRUCT NAME: HvPeer
+ *
+ * DESCRIPTION: A member of the HyParView active view and the tick it was last heard from
+ */
+typedef struct HvPeer {
+    NodeId node;
+    int heard;
+}HvPeer;
+
+/**
+ * STRUCT NAME: Snapshot
+ *
+ * DESCRIPTION: An encoded full membership list, reused until the table or the tick changes.
+ * data is a transport buffer this node holds a reference to. It never carries rumors,
+ * which are counted per message sent.
+ */
+typedef struct Snapshot {
+    char *data;
+    int size;
+    long version;
+    int time;
+}Snapshot;
+
+// what a piggybacked update says about its node
+enum SwimUpdateKind { SWIM_ALIVE, SWIM_SUSPECT, SWIM_FAILED };
+
+/**
+ * STRUCT NAME: SwimUpdate
+ *
+ * DESCRIPTION: A membership update waiting to be piggybacked
+ */
+typedef struct SwimUpdate {
+    NodeId node;
+    SwimUpdateKind kind;
+    // incarnation of the node the news is about
+    long incarnation;
+    // times it has been piggybacked so far
+    int sends;
+}SwimUpdate;
+
+/**
+ * STRUCT NAME: Rumor
+ *
+ * DESCRIPTION: A gossip member's change of memberState waiting to be piggybacked on
+ * HEARTBEATREQs and HEARTBEATREPs
+ */
+typedef struct Rumor {
+    NodeId node;
+    memberState state;
+    long incarnation;
+    // times it has been piggybacked so far
+    int sends;
+}Rumor;
+
+/**
+ * STRUCT NAME: Tombstone
+ *
+ * DESCRIPTION: A member gossip has removed: its last heartbeat, and the tick until
+ * which news of it that is no newer is ignored
+ */
+typedef struct Tombstone {
+    long heartbeat;
+    int until;
+}Tombstone;
+
 /**
  * CLASS NAME: MP1Node
  *
@@ -57,14 +216,74 @@ typedef struct MessageHdr {
  */
 class MP1Node {
 private:
-    EmulNet *emulNet;
+    Transport *emulNet;
     Log *log;
     Params *par;
     Member *memberNode;
+    // Compiled away unless TRACE_LEVEL is set
+    Trace trace;
     char NULLADDR[6];
+    // Private random stream, so that nodes on different threads draw independently
+    Random rng;
+    // Scratch lists reused by every send and receive of a membership list
+    vector<MemberListEntry *> outgoing;
+    vector<MemberListEntry> incoming;
+    // JOINREQs held until the end of checkMessages with JOIN_BATCH
+    vector<Address> pendingJoins;
+    // Messages recvCallBack dropped, per RejectReason
+    long rejected[REJECT_REASONS];
+    // Handler of each message type and version, shared by every node
+    static MsgRoute routes[MSG_TYPES][MSG_VERSIONS];
+    static bool registerMessages();
+    // Full lists last encoded, per message type
+    Snapshot snapshots[DUMMYLASTMSGTYPE];
+    // GOSSIP: DIGEST: a digest round came while the table was still changing, so the
+    // DIGEST waits for the first round after it settles
+    bool digestDue;
+    // Gossip: one timer per member, due when it would count as failed or be removed without news.
+    // SWIM: one per suspicion, due when it runs out.
+    TimingWheel<NodeId> expiry;
+    // Gossip: members removed in the last 2 * TREMOVE ticks. Peers that judge the member
+    // failed later than this node still gossip it meanwhile, and must not bring it back.
+    unordered_map<NodeId, Tombstone> removed;
+    // Gossip with SUSPICION: state changes to piggyback, how many were queued and how many
+    // copies of them went out
+    vector<Rumor> rumors;
+    long rumorsQueued;
+    long rumorSends;
+    // SWIM: the probe in progress, the shuffled round of probe targets, updates to
+    // piggyback, and the members declared failed with the incarnation they failed at;
+    // only news of a newer incarnation brings one back
+    bool probing;
+    NodeId probeTarget;
+    uint32_t probeSeq;
+    bool probeAcked;
+    int probeStart;
+    vector<NodeId> probeOrder;
+    size_t probeNext;
+    vector<SwimUpdate> updates;
+    unordered_map<NodeId, long> deadNodes;
+    vector<int> pingReqPick;
+    // HyParView: the active view this node keeps links to, the passive view it repairs it
+    // from, and the passive member asked to become a neighbor, if any
+    vector<HvPeer> activeView;
+    vector<NodeId> passiveView;
+    bool neighborPending;
+    NodeId neighborTarget;
+    int neighborSince;
+    vector<NodeId> hvList;
+    // HyParView introducer: a uniform sample of everyone who has joined, PASSIVE_VIEW long
+    vector<NodeId> joinSample;
+    int joinsSeen;
+    static bool entryOrder(const MemberListEntry *a, const MemberListEntry *b);
+    void encodeMembershipList(WireWriter &out);
+    void collectMembers(long known, uint64_t buckets);
+    char *buildMembershipList(enum MsgTypes msgType, long known, int *rumorCount, int *size);
+    char *allocMessage(enum MsgTypes msgType, int bodySize);
+    void sendMessage(Address *to, char *body, int bodySize);
 
 public:
-    MP1Node(Member *, Params *, EmulNet *, Log *, Address *);
+    MP1Node(Member *, Params *, Transport *, Log *, Address *);
     Member * getMemberNode() {
         return memberNode;
     }
@@ -76,24 +295,77 @@ public:
     int finishUpThisNode();
     void nodeLoop();
     void checkMessages();
-    int getIdFromAddress(string address);
-    short getPortFromAddress(string address);
 
     bool recvCallBack(void *env, char *data, int size);
+    static void registerMessage(uint8_t msgType, uint8_t version, MsgHandler handler, int minSize, int maxSize);
 
     bool joinReqHandler(void *env, char *data, int size);
     bool joinRepHandler(void *env, char *data, int size);
+    void answerJoins();
+    void joinedGroup();
 
     bool heartbeatReqHandler(void *env, char *data, int size);
     bool heartbeatRepHandler(void *env, char *data, int size);
 
-    void updateMembershipList(int id, short port, long heartbeat);
+    bool updateMembershipList(NodeId node, long heartbeat);
     void updateMembershipList(MemberListEntry& entry);
 
     void sendMembershipList(Address *to, enum MsgTypes msgType);
-    bool recvMembershipList(void *env, char *data, int size, const char * label);
+    bool recvMembershipList(WireReader &in, const char * label);
+
+    void sendDigest(Address *to);
+    void sendDigestSync(Address *to, uint64_t buckets, bool reply);
+    bool digestHandler(void *env, char *data, int size);
+    bool digestRepHandler(void *env, char *data, int size);
+    bool digestSyncHandler(void *env, char *data, int size);
 
     void nodeLoopOps();
+    void scheduleExpiry(MemberListEntry &entry);
+    int failAfter(MemberListEntry &entry);
+    int removeAfter(MemberListEntry &entry);
+    int suspectAfter(MemberListEntry &entry);
+    void heartbeatArrived(MemberListEntry *entry);
+    void expireMembers();
+    void suspectMember(MemberListEntry *entry);
+    void removeMember(MemberListEntry *entry);
+    void addRumor(NodeId node, memberState state, long incarnation);
+    int writeRumors(WireWriter &out);
+    bool readRumors(WireReader &in);
+
+    void swimLoopOps();
+    bool nextProbeTarget(NodeId *target);
+    void sendPingReqs();
+    void sendSwim(enum MsgTypes msgType, NodeId to, NodeId origin, NodeId target, uint32_t seq);
+    bool recvSwim(const WireView<SwimWire> &msg);
+    void heardFrom(NodeId node);
+    void expireSuspects();
+    void swimSuspect(MemberListEntry *entry, long incarnation);
+    void declareFailed(NodeId node, long incarnation);
+    void refute(long incarnation);
+    void addUpdate(NodeId node, SwimUpdateKind kind, long incarnation);
+    void writeUpdates(WireWriter &out);
+    bool readUpdates(WireReader &in);
+    bool pingHandler(void *env, char *data, int size);
+    bool pingReqHandler(void *env, char *data, int size);
+    bool ackHandler(void *env, char *data, int size);
+
+    void hvLoopOps();
+    void hvJoin(NodeId node);
+    int hvFindActive(NodeId node);
+    void hvAddActive(NodeId node);
+    void hvRemoveActive(int pos, bool failed);
+    void hvAddPassive(NodeId node);
+    void hvRemovePassive(NodeId node);
+    void hvSample(const vector<NodeId> &from, int count, vector<NodeId> &out);
+    void hvSend(enum MsgTypes msgType, NodeId to, NodeId node, int ttl, int flag, const vector<NodeId> *list);
+    bool hvRecv(const WireView<HvWire> &msg, vector<NodeId> *list);
+    bool forwardJoinHandler(void *env, char *data, int size);
+    bool neighborHandler(void *env, char *data, int size);
+    bool neighborRepHandler(void *env, char *data, int size);
+    bool disconnectHandler(void *env, char *data, int size);
+    bool shuffleHandler(void *env, char *data, int size);
+    bool shuffleRepHandler(void *env, char *data, int size);
+    bool keepAliveHandler(void *env, char *data, int size);
 
     int isNullAddress(Address *addr);
     Address getJoinAddress();
@@ -40,12 +40,12 @@ bool Address::operator ==(const Address& anotherAddress) {
 /**
  * Constructor
  */
-MemberListEntry::MemberListEntry(int id, short port, long heartbeat, long timestamp): id(id), port(port), heartbeat(heartbeat), timestamp(timestamp) {}
+MemberListEntry::MemberListEntry(int id, short port, long heartbeat, long timestamp): id(id), port(port), heartbeat(heartbeat), timestamp(timestamp), version(0), state(MEMBER_ALIVE), incarnation(0) {}
 
 /**
  * Constuctor
  */
-MemberListEntry::MemberListEntry(int id, short port): id(id), port(port) {}
+MemberListEntry::MemberListEntry(int id, short port): id(id), port(port), version(0), state(MEMBER_ALIVE), incarnation(0) {}
 
 /**
  * Copy constructor
@@ -55,6 +55,10 @@ MemberListEntry::MemberListEntry(const MemberListEntry &anotherMLE) {
 	this->id = anotherMLE.id;
 	this->port = anotherMLE.port;
 	this->timestamp = anotherMLE.timestamp;
+	this->version = anotherMLE.version;
+	this->arrivals = anotherMLE.arrivals;
+	this->state = anotherMLE.state;
+	this->incarnation = anotherMLE.incarnation;
 }
 
 /**
@@ -66,6 +70,10 @@ MemberListEntry& MemberListEntry::operator =(const MemberListEntry &anotherMLE)
 	swap(id, temp.id);
 	swap(port, temp.port);
 	swap(timestamp, temp.timestamp);
+	swap(version, temp.version);
+	swap(arrivals, temp.arrivals);
+	swap(state, temp.state);
+	swap(incarnation, temp.incarnation);
 	return *this;
 }
 
@@ -154,7 +162,14 @@ Member::Member(const Member &anotherMember) {
 	this->pingCounter = anotherMember.pingCounter;
 	this->timeOutCounter = anotherMember.timeOutCounter;
 	this->memberList = anotherMember.memberList;
+	this->memberIndex = anotherMember.memberIndex;
+	this->digest = anotherMember.digest;
 	this->myPos = anotherMember.myPos;
+	this->listVersion = anotherMember.listVersion;
+	this->gossipRounds = anotherMember.gossipRounds;
+	this->roundVersions = anotherMember.roundVersions;
+	this->joinStart = anotherMember.joinStart;
+	this->joinTicks = anotherMember.joinTicks;
 	this->mp1q = anotherMember.mp1q;
 }
 
@@ -171,7 +186,209 @@ Member& Member::operator =(const Member& anotherMember) {
 	this->pingCounter = anotherMember.pingCounter;
 	this->timeOutCounter = anotherMember.timeOutCounter;
 	this->memberList = anotherMember.memberList;
+	this->memberIndex = anotherMember.memberIndex;
+	this->digest = anotherMember.digest;
 	this->myPos = anotherMember.myPos;
+	this->listVersion = anotherMember.listVersion;
+	this->gossipRounds = anotherMember.gossipRounds;
+	this->roundVersions = anotherMember.roundVersions;
+	this->joinStart = anotherMember.joinStart;
+	this->joinTicks = anotherMember.joinTicks;
 	this->mp1q = anotherMember.mp1q;
 	return *this;
 }
+
+/**
+ * FUNCTION NAME: findMember
+ *
+ * DESCRIPTION: Entry of the member with this id and port, or NULL if it is not in the table
+ */
+MemberListEntry *Member::findMember(NodeId node) {
+	int pos = memberIndex.find(node);
+	return pos < 0 ? NULL : &memberList[pos];
+}
+
+/**
+ * FUNCTION NAME: addMember
+ *
+ * DESCRIPTION: Append an entry to the membership table
+ */
+void Member::addMember(const MemberListEntry &entry) {
+	memberIndex.insert(entry.getnodeid(), (int)memberList.size());
+	digest.toggle(entry.getnodeid().v, entry.heartbeat);
+	memberList.push_back(entry);
+	memberList.back().version = ++listVersion;
+	myPos = memberList.begin();
+}
+
+/**
+ * FUNCTION NAME: setHeartbeat
+ *
+ * DESCRIPTION: Give an entry a new heartbeat, keeping the digest in step, and stamp it
+ * 				with a new table version
+ */
+void Member::setHeartbeat(MemberListEntry *entry, long heartbeat) {
+	digest.toggle(entry->getnodeid().v, entry->heartbeat);
+	entry->heartbeat = heartbeat;
+	digest.toggle(entry->getnodeid().v, entry->heartbeat);
+	touchMember(entry);
+}
+
+/**
+ * FUNCTION NAME: touchMember
+ *
+ * DESCRIPTION: Stamp an entry whose heartbeat just changed with a new table version
+ */
+void Member::touchMember(MemberListEntry *entry) {
+	entry->version = ++listVersion;
+}
+
+/**
+ * FUNCTION NAME: eraseMember
+ *
+ * DESCRIPTION: Remove the entry at pos by moving the last entry into its place, so the
+ * 				rest of the table stays put. The caller must look at pos again.
+ */
+void Member::eraseMember(int pos) {
+	MemberListEntry &victim = memberList[pos];
+	memberIndex.erase(victim.getnodeid());
+	digest.toggle(victim.getnodeid().v, victim.heartbeat);
+
+	int last = (int)memberList.size() - 1;
+	if ( pos != last ) {
+		memberList[pos] = memberList[last];
+		memberIndex.move(memberList[pos].getnodeid(), pos);
+	}
+	memberList.pop_back();
+	myPos = memberList.begin();
+}
+
+/**
+ * FUNCTION NAME: clearMembers
+ *
+ * DESCRIPTION: Empty the membership table
+ */
+void Member::clearMembers() {
+	memberList.clear();
+	memberIndex.clear();
+	digest.clear();
+}
+
+/**
+ * FUNCTION NAME: slotOf
+ *
+ * DESCRIPTION: Slot holding node, or the empty slot where probing for it ends
+ */
+int MemberIndex::slotOf(NodeId node) const {
+	unsigned int mask = slots.size() - 1;
+	unsigned int i = home(node);
+	while ( slots[i].pos >= 0 && slots[i].node != node ) {
+		i = (i + 1) & mask;
+	}
+	return (int)i;
+}
+
+/**
+ * FUNCTION NAME: grow
+ *
+ * DESCRIPTION: Double the table and reinsert every entry
+ */
+void MemberIndex::grow() {
+	vector<Slot> old;
+	old.swap(slots);
+
+	Slot empty;
+	empty.pos = -1;
+	slots.assign(old.empty() ? 16 : old.size() * 2, empty);
+
+	for ( size_t i = 0; i < old.size(); i++ ) {
+		if ( old[i].pos >= 0 ) {
+			slots[slotOf(old[i].node)] = old[i];
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: find
+ *
+ * DESCRIPTION: Position of node in the membership table, or -1
+ */
+int MemberIndex::find(NodeId node) const {
+	if ( slots.empty() ) {
+		return -1;
+	}
+	return slots[slotOf(node)].pos;
+}
+
+/**
+ * FUNCTION NAME: insert
+ *
+ * DESCRIPTION: Record that node sits at pos
+ */
+void MemberIndex::insert(NodeId node, int pos) {
+	if ( 2 * (count + 1) > (int)slots.size() ) {
+		grow();
+	}
+	Slot &slot = slots[slotOf(node)];
+	if ( slot.pos < 0 ) {
+		count++;
+	}
+	slot.node = node;
+	slot.pos = pos;
+}
+
+/**
+ * FUNCTION NAME: move
+ *
+ * DESCRIPTION: Record that node, already indexed, now sits at pos
+ */
+void MemberIndex::move(NodeId node, int pos) {
+	Slot &slot = slots[slotOf(node)];
+	assert(slot.pos >= 0);
+	slot.pos = pos;
+}
+
+/**
+ * FUNCTION NAME: erase
+ *
+ * DESCRIPTION: Forget node. Entries probed past the freed slot are shifted back
+ * 				so that every lookup still finds its entry before an empty slot.
+ */
+void MemberIndex::erase(NodeId node) {
+	if ( slots.empty() ) {
+		return;
+	}
+	unsigned int mask = slots.size() - 1;
+	unsigned int i = slotOf(node);
+	if ( slots[i].pos < 0 ) {
+		return;
+	}
+	count--;
+
+	unsigned int j = i;
+	while ( true ) {
+		j = (j + 1) & mask;
+		if ( slots[j].pos < 0 ) {
+			break;
+		}
+		// an entry may fill the hole only if the hole lies between its home and j
+		unsigned int k = home(slots[j].node);
+		if ( ((j - k) & mask) >= ((j - i) & mask) ) {
+			slots[i] = slots[j];
+			i = j;
+		}
+	}
+	slots[i].pos = -1;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Forget every entry
+ */
+void MemberIndex::clear() {
+	for ( size_t i = 0; i < slots.size(); i++ ) {
+		slots[i].pos = -1;
+	}
+	count = 0;
+}
@@ -8,6 +8,9 @@
 #define MEMBER_H_
 
 #include "stdincludes.h"
+#include "RingBuffer.h"
+#include "PhiAccrual.h"
+#include "Digest.h"
 
 /**
  * CLASS NAME: q_elt
@@ -18,9 +21,50 @@ class q_elt {
 public:
 	void *elt;
 	int size;
+	q_elt(): elt(NULL), size(0) {}
 	q_elt(void *elt, int size);
 };
 
+class Address;
+
+/**
+ * CLASS NAME: NodeId
+ *
+ * DESCRIPTION: A node's id and port packed into one integer: id in the low 32 bits, port
+ * 				in the next 16. Trivially copyable and compared, hashed and converted to and
+ * 				from Address without going through a string.
+ */
+class NodeId {
+public:
+	uint64_t v;
+	constexpr NodeId(): v(0) {}
+	constexpr NodeId(int id, short port): v((uint64_t)(uint32_t)id | (uint64_t)(uint16_t)port << 32) {}
+	constexpr explicit NodeId(const Address &address);
+	constexpr int getid() const {
+		return (int)(uint32_t)v;
+	}
+	constexpr short getport() const {
+		return (short)(uint16_t)(v >> 32);
+	}
+	constexpr bool operator ==(const NodeId &another) const {
+		return v == another.v;
+	}
+	constexpr bool operator !=(const NodeId &another) const {
+		return v != another.v;
+	}
+	constexpr unsigned int hash() const {
+		return (unsigned int)((v * 0x9E3779B97F4A7C15ULL) >> 32);
+	}
+};
+
+namespace std {
+template<> struct hash<NodeId> {
+	size_t operator()(const NodeId &n) const {
+		return n.hash();
+	}
+};
+}
+
 /**
  * CLASS NAME: Address
  *
@@ -30,6 +74,8 @@ class Address {
 public:
 	char addr[6];
 	Address() {}
+	// The bytes of the id and the port, in the little-endian order memcpy gives them here
+	constexpr Address(const NodeId &n): addr{ (char)n.v, (char)(n.v >> 8), (char)(n.v >> 16), (char)(n.v >> 24), (char)(n.v >> 32), (char)(n.v >> 40) } {}
 	// Copy constructor
 	Address(const Address &anotherAddress);
 	 // Overloaded = operator
@@ -54,6 +100,16 @@ public:
 	}
 };
 
+constexpr NodeId::NodeId(const Address &address): v((uint64_t)(unsigned char)address.addr[0]
+		| (uint64_t)(unsigned char)address.addr[1] << 8
+		| (uint64_t)(unsigned char)address.addr[2] << 16
+		| (uint64_t)(unsigned char)address.addr[3] << 24
+		| (uint64_t)(unsigned char)address.addr[4] << 32
+		| (uint64_t)(unsigned char)address.addr[5] << 40) {}
+
+// what the group is told about a member; a member only leaves the table as DEAD
+enum memberState { MEMBER_ALIVE, MEMBER_SUSPECT, MEMBER_DEAD };
+
 /**
  * CLASS NAME: MemberListEntry
  *
@@ -65,13 +121,25 @@ public:
 	short port;
 	long heartbeat;
 	long timestamp;
+	// Member::listVersion when this entry last changed
+	long version;
+	// gaps between this member's recent heartbeats, for FAILURE_DETECTOR: PHI
+	PhiAccrual arrivals;
+	// the memberState last heard of, and the member's incarnation: it bumps it to refute
+	// a suspicion, and news about an older incarnation is stale
+	unsigned char state;
+	long incarnation;
 	MemberListEntry(int id, short port, long heartbeat, long timestamp);
 	MemberListEntry(int id, short port);
-	MemberListEntry(): id(0), port(0), heartbeat(0), timestamp(0) {}
+	MemberListEntry(NodeId node, long heartbeat, long timestamp): id(node.getid()), port(node.getport()), heartbeat(heartbeat), timestamp(timestamp), version(0), state(MEMBER_ALIVE), incarnation(0) {}
+	MemberListEntry(): id(0), port(0), heartbeat(0), timestamp(0), version(0), state(MEMBER_ALIVE), incarnation(0) {}
 	MemberListEntry(const MemberListEntry &anotherMLE);
 	MemberListEntry& operator =(const MemberListEntry &anotherMLE);
 	int getid();
 	short getport();
+	NodeId getnodeid() const {
+		return NodeId(id, port);
+	}
 	long getheartbeat();
 	long gettimestamp();
 	void setid(int id);
@@ -80,6 +148,39 @@ public:
 	void settimestamp(long timestamp);
 };
 
+/**
+ * CLASS NAME: MemberIndex
+ *
+ * DESCRIPTION: Open-addressing hash index from (id, port) to a position in the membership
+ * 				table. Linear probing, at most half full; erase shifts the following run back
+ * 				instead of leaving tombstones.
+ */
+class MemberIndex {
+private:
+	struct Slot {
+		NodeId node;
+		// position in the membership table, -1 for an empty slot
+		int pos;
+	};
+	vector<Slot> slots;
+	int count;
+	unsigned int home(NodeId node) const {
+		return node.hash() & (slots.size() - 1);
+	}
+	int slotOf(NodeId node) const;
+	void grow();
+public:
+	MemberIndex(): count(0) {}
+	int find(NodeId node) const;
+	void insert(NodeId node, int pos);
+	void move(NodeId node, int pos);
+	void erase(NodeId node);
+	void clear();
+	int size() const {
+		return count;
+	}
+};
+
 /**
  * CLASS NAME: Member
  *
@@ -106,19 +207,38 @@ public:
 	int timeOutCounter;
 	// Membership table
 	vector<MemberListEntry> memberList;
+	// Where each (id, port) sits in memberList; kept in sync by the member functions below
+	MemberIndex memberIndex;
+	// Who is in memberList at which heartbeat, for GOSSIP: DIGEST; kept in sync like memberIndex
+	MembershipDigest digest;
 	// My position in the membership table
 	vector<MemberListEntry>::iterator myPos;
+	// bumped on every change to the table
+	long listVersion;
+	// heartbeat gossip rounds so far, for the periodic full sync
+	int gossipRounds;
+	// listVersion at the start of each of the last DELTA_ROUNDS gossip rounds, by round
+	vector<long> roundVersions;
+	// tick the node started, and the ticks it then took to get into the group, -1 until it has
+	int joinStart;
+	int joinTicks;
 	// Queue for failure detection messages
-	queue<q_elt> mp1q;
+	RingBuffer<q_elt> mp1q;
 	/**
 	 * Constructor
 	 */
-	Member(): inited(false), inGroup(false), bFailed(false), nnb(0), heartbeat(0), pingCounter(0), timeOutCounter(0) {}
+	Member(): inited(false), inGroup(false), bFailed(false), nnb(0), heartbeat(0), pingCounter(0), timeOutCounter(0), listVersion(0), gossipRounds(0), joinStart(0), joinTicks(-1) {}
 	// copy constructor
 	Member(const Member &anotherMember);
 	// Assignment operator overloading
 	Member& operator =(const Member &anotherMember);
 	virtual ~Member() {}
+	MemberListEntry *findMember(NodeId node);
+	void addMember(const MemberListEntry &entry);
+	void eraseMember(int pos);
+	void setHeartbeat(MemberListEntry *entry, long heartbeat);
+	void touchMember(MemberListEntry *entry);
+	void clearMembers();
 };
 
 #endif /* MEMBER_H_ */
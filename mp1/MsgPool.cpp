@@ -0,0 +1,109 @@
+/**********************************
+ * FILE NAME: MsgPool.cpp
+ *
+ * DESCRIPTION: Definition of the MsgPool class
+ **********************************/
+
+#include "MsgPool.h"
+
+/**
+ * Constructor
+ */
+MsgPool::MsgPool(): heapAllocs(0), acquires(0), releases(0), inUse(0), peakInUse(0) {
+	for ( int i = 0; i < MSGPOOL_NUM_CLASSES; i++ ) {
+		freelist[i] = NULL;
+	}
+}
+
+/**
+ * Destructor
+ */
+MsgPool::~MsgPool() {
+	for ( size_t i = 0; i < slabs.size(); i++ ) {
+		free(slabs[i]);
+	}
+}
+
+/**
+ * FUNCTION NAME: refill
+ *
+ * DESCRIPTION: Carve a new slab into free blocks of the given class
+ */
+void MsgPool::refill(int cls) {
+	int blockSize = MSGPOOL_MIN_BLOCK << cls;
+	int nblocks = MSGPOOL_SLAB_SIZE / blockSize;
+	if ( nblocks < 1 ) {
+		nblocks = 1;
+	}
+
+	char *slab = (char *) malloc(nblocks * blockSize);
+	slabs.push_back(slab);
+	heapAllocs++;
+
+	for ( int i = nblocks - 1; i >= 0; i-- ) {
+		MsgBufHdr *hdr = (MsgBufHdr *)(slab + i * blockSize);
+		hdr->cls = cls;
+		hdr->next = freelist[cls];
+		freelist[cls] = hdr;
+	}
+}
+
+/**
+ * FUNCTION NAME: acquire
+ *
+ * DESCRIPTION: Return a buffer able to hold size bytes
+ */
+char *MsgPool::acquire(int size) {
+	MsgBufHdr *hdr;
+	int cls = 0;
+	int need = size + (int)sizeof(MsgBufHdr);
+
+	while ( cls < MSGPOOL_NUM_CLASSES && (MSGPOOL_MIN_BLOCK << cls) < need ) {
+		cls++;
+	}
+
+	if ( cls == MSGPOOL_NUM_CLASSES ) {
+		hdr = (MsgBufHdr *) malloc(need);
+		hdr->cls = -1;
+		heapAllocs++;
+	}
+	else {
+		if ( NULL == freelist[cls] ) {
+			refill(cls);
+		}
+		hdr = freelist[cls];
+		freelist[cls] = hdr->next;
+	}
+
+	hdr->refs = 1;
+	acquires++;
+	if ( ++inUse > peakInUse ) {
+		peakInUse = inUse;
+	}
+	return (char *)(hdr + 1);
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Drop a reference to a buffer obtained from acquire; the last one gives it
+ * 				back to this pool, whichever pool it came from
+ */
+void MsgPool::release(char *buf) {
+	MsgBufHdr *hdr = (MsgBufHdr *)buf - 1;
+
+	// holders on other threads may release concurrently
+	if ( __atomic_sub_fetch(&hdr->refs, 1, __ATOMIC_ACQ_REL) > 0 ) {
+		return;
+	}
+
+	releases++;
+	inUse--;
+
+	if ( hdr->cls < 0 ) {
+		free(hdr);
+		return;
+	}
+	hdr->next = freelist[hdr->cls];
+	freelist[hdr->cls] = hdr;
+}
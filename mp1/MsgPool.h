@@ -0,0 +1,83 @@
+/**********************************
+ * FILE NAME: MsgPool.h
+ *
+ * DESCRIPTION: Slab allocator for network message buffers
+ **********************************/
+
+#ifndef MSGPOOL_H_
+#define MSGPOOL_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// bytes carved into blocks each time a size class runs dry
+#define MSGPOOL_SLAB_SIZE (64 * 1024)
+// smallest block, header included; each following class doubles it
+#define MSGPOOL_MIN_BLOCK 64
+#define MSGPOOL_NUM_CLASSES 8
+
+/**
+ * STRUCT NAME: MsgBufHdr
+ *
+ * DESCRIPTION: Bookkeeping that sits in front of every pooled buffer
+ */
+typedef struct MsgBufHdr {
+	// Next free block of the same class
+	struct MsgBufHdr *next;
+	// Size class, or -1 for an oversize buffer taken straight from the heap
+	int cls;
+	// Holders of the buffer; the last release gives it back
+	int refs;
+}MsgBufHdr;
+
+/**
+ * CLASS NAME: MsgPool
+ *
+ * DESCRIPTION: Hands out message buffers from per-size-class free lists backed by slabs.
+ * 				Released buffers go back on their free list, so once the pool has grown to
+ * 				the peak number of in-flight messages it no longer touches the heap.
+ *
+ * 				A buffer may be retained to share it, for instance between the receivers of
+ * 				one message; it goes back to the pool when every holder has released it.
+ */
+class MsgPool {
+private:
+	MsgBufHdr *freelist[MSGPOOL_NUM_CLASSES];
+	vector<char *> slabs;
+	// heap allocations made by this pool (slabs plus oversize buffers)
+	long heapAllocs;
+	long acquires;
+	long releases;
+	int inUse;
+	int peakInUse;
+	MsgPool(const MsgPool &anotherPool);
+	MsgPool& operator =(const MsgPool &anotherPool);
+	void refill(int cls);
+public:
+	MsgPool();
+	virtual ~MsgPool();
+	char *acquire(int size);
+	void release(char *buf);
+	static void retain(char *buf) {
+		__atomic_add_fetch(&((MsgBufHdr *)buf - 1)->refs, 1, __ATOMIC_RELAXED);
+	}
+	long getHeapAllocs() {
+		return heapAllocs;
+	}
+	long getAcquires() {
+		return acquires;
+	}
+	long getReleases() {
+		return releases;
+	}
+	int getInUse() {
+		return inUse;
+	}
+	int getPeakInUse() {
+		return peakInUse;
+	}
+};
+
+#endif /* MSGPOOL_H_ */
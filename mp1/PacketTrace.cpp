@@ -0,0 +1,168 @@
+/**********************************
+ * FILE NAME: PacketTrace.cpp
+ *
+ * DESCRIPTION: Definition of the PacketTrace class
+ **********************************/
+
+#include "PacketTrace.h"
+
+/**
+ * Constructor
+ */
+PacketTrace::PacketTrace(): out(NULL), map(NULL), mapSize(0), delivered(0), dropped(0) {}
+
+/**
+ * Destructor
+ */
+PacketTrace::~PacketTrace() {
+	close();
+}
+
+/**
+ * FUNCTION NAME: openCapture
+ *
+ * DESCRIPTION: Start a new trace file
+ *
+ * RETURNS:
+ * false if the file cannot be written
+ */
+bool PacketTrace::openCapture(const char *file) {
+	out = fopen(file, "wb");
+	if ( NULL == out ) {
+		return false;
+	}
+	setvbuf(out, NULL, _IOFBF, TRACE_BUFSIZE);
+	fwrite(TRACE_MAGIC, 1, TRACE_MAGIC_LEN, out);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: capture
+ *
+ * DESCRIPTION: Append one entry. The entry is written with a single fwrite, which stdio
+ * 				serializes, so receivers on several threads may capture at once.
+ */
+void PacketTrace::capture(int tick, int sent, Address &from, Address &to, char *data, int size, traceOutcome outcome) {
+	static thread_local vector<char> entry;
+	TraceRecord rec;
+
+	if ( NULL == out ) {
+		return;
+	}
+
+	memset(&rec, 0, sizeof(rec));
+	rec.tick = tick;
+	rec.sent = sent;
+	rec.size = size;
+	rec.outcome = (unsigned char)outcome;
+	memcpy(rec.from, from.addr, sizeof(rec.from));
+	memcpy(rec.to, to.addr, sizeof(rec.to));
+
+	size_t padded = (size + TRACE_ALIGN - 1) & ~(size_t)(TRACE_ALIGN - 1);
+	entry.assign(sizeof(rec) + padded, 0);
+	memcpy(&entry[0], &rec, sizeof(rec));
+	memcpy(&entry[sizeof(rec)], data, size);
+	fwrite(&entry[0], 1, entry.size(), out);
+}
+
+/**
+ * FUNCTION NAME: openReplay
+ *
+ * DESCRIPTION: Map a trace file and index its delivered messages
+ *
+ * RETURNS:
+ * false if the file is missing or is not a trace
+ */
+bool PacketTrace::openReplay(const char *file) {
+	struct stat st;
+	int fd = open(file, O_RDONLY);
+	if ( fd < 0 ) {
+		return false;
+	}
+	if ( fstat(fd, &st) < 0 || st.st_size < TRACE_MAGIC_LEN ) {
+		::close(fd);
+		return false;
+	}
+
+	// private and writable, so a receiver that scribbles on its buffer only touches its copy
+	mapSize = st.st_size;
+	map = (char *) mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if ( map == MAP_FAILED || 0 != memcmp(map, TRACE_MAGIC, TRACE_MAGIC_LEN) ) {
+		if ( map != MAP_FAILED ) {
+			munmap(map, mapSize);
+		}
+		map = NULL;
+		return false;
+	}
+
+	size_t pos = TRACE_MAGIC_LEN;
+	while ( pos + sizeof(TraceRecord) <= mapSize ) {
+		TraceRecord *rec = (TraceRecord *)(map + pos);
+		size_t padded = (rec->size + TRACE_ALIGN - 1) & ~(size_t)(TRACE_ALIGN - 1);
+		if ( rec->size < 0 || pos + sizeof(TraceRecord) + padded > mapSize ) {
+			// a capture cut short; replay what is complete
+			break;
+		}
+		if ( rec->outcome == TRACE_DELIVERED ) {
+			int dst;
+			memcpy(&dst, rec->to, sizeof(int));
+			if ( dst < 0 ) {
+				break;
+			}
+			if ( dst >= (int)byDst.size() ) {
+				byDst.resize(dst + 1);
+			}
+			byDst[dst].push_back(rec);
+			delivered++;
+		}
+		else {
+			dropped++;
+		}
+		pos += sizeof(TraceRecord) + padded;
+	}
+	cursor.assign(byDst.size(), 0);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: replay
+ *
+ * DESCRIPTION: Hand dst every message it received up to tick time. The buffers point
+ * 				into the mapping and must not be given back to a message pool.
+ *
+ * RETURNS:
+ * number of messages handed over; their sizes are added to bytes
+ */
+int PacketTrace::replay(int dst, int time, int (* enq)(void *, char *, int), void *queue, long &bytes) {
+	if ( dst < 0 || dst >= (int)byDst.size() ) {
+		return 0;
+	}
+
+	vector<TraceRecord *> &list = byDst[dst];
+	size_t &next = cursor[dst];
+	int count = 0;
+	while ( next < list.size() && list[next]->tick <= time ) {
+		TraceRecord *rec = list[next++];
+		(*enq)(queue, (char *)(rec + 1), rec->size);
+		bytes += rec->size;
+		count++;
+	}
+	return count;
+}
+
+/**
+ * FUNCTION NAME: close
+ *
+ * DESCRIPTION: Flush a capture, or unmap a replayed trace
+ */
+void PacketTrace::close() {
+	if ( out ) {
+		fclose(out);
+		out = NULL;
+	}
+	if ( map ) {
+		munmap(map, mapSize);
+		map = NULL;
+	}
+}
@@ -0,0 +1,86 @@
+/**********************************
+ * FILE NAME: PacketTrace.h
+ *
+ * DESCRIPTION: Binary capture and replay of EmulNet traffic
+ **********************************/
+
+#ifndef PACKETTRACE_H_
+#define PACKETTRACE_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Macros
+ */
+// first bytes of every trace file, bump the digits when TraceRecord changes
+#define TRACE_MAGIC "MP1TRC01"
+#define TRACE_MAGIC_LEN 8
+// records and payloads start on multiples of this
+#define TRACE_ALIGN 8
+// stdio buffer of the capture file
+#define TRACE_BUFSIZE (1 << 20)
+
+// what became of a captured message
+enum traceOutcome { TRACE_DELIVERED, TRACE_DROPPED_PROB, TRACE_DROPPED_CAPACITY, TRACE_DROPPED_OVERSIZE };
+
+/**
+ * STRUCT NAME: TraceRecord
+ *
+ * DESCRIPTION: Fixed part of a trace entry; size bytes of payload follow it, padded to TRACE_ALIGN
+ */
+typedef struct TraceRecord {
+	// Tick of the outcome: when the receiver got the message, or when it was dropped
+	int tick;
+	// Tick the message was sent
+	int sent;
+	int size;
+	unsigned char outcome;
+	unsigned char pad[3];
+	char from[6];
+	char to[6];
+	char pad2[4];
+}TraceRecord;
+
+/**
+ * CLASS NAME: PacketTrace
+ *
+ * DESCRIPTION: An append-only file with one entry per message. Capture appends entries
+ * 				from any thread, one fwrite each. Replay maps the file and indexes the
+ * 				delivered messages by destination, so each can be handed to the receiver
+ * 				at its tick straight from the mapping.
+ */
+class PacketTrace {
+private:
+	FILE *out;
+	char *map;
+	size_t mapSize;
+	// delivered entries per destination id, in the order they were received
+	vector< vector<TraceRecord *> > byDst;
+	vector<size_t> cursor;
+	long delivered;
+	long dropped;
+	PacketTrace(const PacketTrace &anotherTrace);
+	PacketTrace& operator =(const PacketTrace &anotherTrace);
+public:
+	PacketTrace();
+	virtual ~PacketTrace();
+	bool openCapture(const char *file);
+	bool openReplay(const char *file);
+	void capture(int tick, int sent, Address &from, Address &to, char *data, int size, traceOutcome outcome);
+	int replay(int dst, int time, int (* enq)(void *, char *, int), void *queue, long &bytes);
+	bool owns(char *data) {
+		return map != NULL && data >= map && data < map + mapSize;
+	}
+	long getDelivered() {
+		return delivered;
+	}
+	long getDropped() {
+		return dropped;
+	}
+	void close();
+};
+
+#endif /* PACKETTRACE_H_ */
@@ -24,10 +24,54 @@ void Params::setparams(char *config_file) {
 	fscanf(fp,"\nDROP_MSG: %d", &DROP_MSG);
 	fscanf(fp,"\nMSG_DROP_PROB: %lf", &MSG_DROP_PROB);
 
+	// Optional settings follow as "KEY: value" lines
+	MSGCOUNT_WINDOW = 1000;
+	EN_BUFFSIZE = 0;
+	EN_OVERFLOW = DROP_NEWEST;
+	LINK_DELAY = 0;
+	LINK_SPREAD = 0;
+	LINK_JITTER = 0;
+	THREADS = 1;
+	TRANSPORT = EMULNET_TRANSPORT;
+	LOCAL_FIRST = 1;
+	LOCAL_LAST = INT_MAX;
+	TICK_USEC = 0;
+	SEED = (unsigned long) time(NULL);
+	GOSSIP = FULL_GOSSIP;
+	FULL_SYNC_PERIOD = 10;
+	DELTA_ROUNDS = 0;
+	HEARTBEAT_EPOCH = 0;
+	PROTOCOL = GOSSIP_PROTOCOL;
+	SWIM_PERIOD = 6;
+	SWIM_TIMEOUT = 2;
+	SWIM_K = 3;
+	SWIM_SUSPECT = 24;
+	JOIN_BATCH = 0;
+	FAILURE_DETECTOR = FIXED_DETECTOR;
+	PHI_THRESHOLD = 8;
+	ACTIVE_VIEW = 5;
+	PASSIVE_VIEW = 30;
+	SHUFFLE_PERIOD = 10;
+	SUSPICION = 1;
+	STEP_RATE = .25;
+	char key[64], value[64];
+	while ( fscanf(fp, " %63[^:]: %63s", key, value) == 2 ) {
+		setparam(key, value);
+	}
+
+	// a delta only leaves out the entries that did not change, and with a heartbeat every
+	// tick all of them do; so unless told otherwise DELTA and DIGEST beat less often
+	if ( HEARTBEAT_EPOCH == 0 ) {
+		HEARTBEAT_EPOCH = GOSSIP == FULL_GOSSIP ? 1 : 20;
+	}
+	// digests find what the pushes missed, so DIGEST needs to push less
+	if ( DELTA_ROUNDS == 0 ) {
+		DELTA_ROUNDS = GOSSIP == DIGEST_GOSSIP ? 6 : 8;
+	}
+
 	//printf("Parameters of the test case: %d %d %d %lf\n", MAX_NNB, SINGLE_FAILURE, DROP_MSG, MSG_DROP_PROB);
 
 	EN_GPSZ = MAX_NNB;
-	STEP_RATE=.25;
 	MAX_MSG_SIZE = 4000;
 	globaltime = 0;
 	dropmsg = 0;
@@ -39,6 +83,134 @@ void Params::setparams(char *config_file) {
 	return;
 }
 
+/**
+ * FUNCTION NAME: setparam
+ *
+ * DESCRIPTION: Set one of the optional parameters of this test case
+ */
+void Params::setparam(const char *key, const char *value) {
+	if ( 0 == strcmp(key, "MSGCOUNT_WINDOW") ) {
+		MSGCOUNT_WINDOW = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "EN_BUFFSIZE") ) {
+		EN_BUFFSIZE = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "EN_OVERFLOW") ) {
+		EN_OVERFLOW = (0 == strcmp(value, "DROP_OLDEST_FOR_DEST")) ? DROP_OLDEST_FOR_DEST : DROP_NEWEST;
+	}
+	else if ( 0 == strcmp(key, "LINK_DELAY") ) {
+		LINK_DELAY = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "LINK_SPREAD") ) {
+		LINK_SPREAD = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "LINK_JITTER") ) {
+		LINK_JITTER = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "THREADS") ) {
+		THREADS = max(1, atoi(value));
+	}
+	else if ( 0 == strcmp(key, "TRANSPORT") ) {
+		if ( 0 == strcmp(value, "UDP") ) {
+			TRANSPORT = UDP_TRANSPORT;
+		}
+		else if ( 0 == strcmp(value, "URING") ) {
+			TRANSPORT = URING_TRANSPORT;
+		}
+		else {
+			TRANSPORT = EMULNET_TRANSPORT;
+		}
+	}
+	else if ( 0 == strcmp(key, "LOCAL_NODES") ) {
+		// "first-last", or a single id
+		if ( sscanf(value, "%d-%d", &LOCAL_FIRST, &LOCAL_LAST) == 1 ) {
+			LOCAL_LAST = LOCAL_FIRST;
+		}
+	}
+	else if ( 0 == strcmp(key, "TICK_USEC") ) {
+		TICK_USEC = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "SEED") ) {
+		SEED = strtoul(value, NULL, 10);
+	}
+	else if ( 0 == strcmp(key, "EN_TRACE") ) {
+		EN_TRACE = value;
+	}
+	else if ( 0 == strcmp(key, "EN_REPLAY") ) {
+		EN_REPLAY = value;
+	}
+	else if ( 0 == strcmp(key, "GOSSIP") ) {
+		if ( 0 == strcmp(value, "DELTA") ) {
+			GOSSIP = DELTA_GOSSIP;
+		}
+		else if ( 0 == strcmp(value, "DIGEST") ) {
+			GOSSIP = DIGEST_GOSSIP;
+		}
+		else {
+			GOSSIP = FULL_GOSSIP;
+		}
+	}
+	else if ( 0 == strcmp(key, "FULL_SYNC_PERIOD") ) {
+		FULL_SYNC_PERIOD = max(1, atoi(value));
+	}
+	else if ( 0 == strcmp(key, "DELTA_ROUNDS") ) {
+		DELTA_ROUNDS = max(1, atoi(value));
+	}
+	else if ( 0 == strcmp(key, "HEARTBEAT_EPOCH") ) {
+		HEARTBEAT_EPOCH = max(1, atoi(value));
+	}
+	else if ( 0 == strcmp(key, "PROTOCOL") ) {
+		if ( 0 == strcmp(value, "SWIM") ) {
+			PROTOCOL = SWIM_PROTOCOL;
+		}
+		else if ( 0 == strcmp(value, "HYPARVIEW") ) {
+			PROTOCOL = HYPARVIEW_PROTOCOL;
+		}
+		else {
+			PROTOCOL = GOSSIP_PROTOCOL;
+		}
+	}
+	else if ( 0 == strcmp(key, "SWIM_PERIOD") ) {
+		SWIM_PERIOD = max(1, atoi(value));
+	}
+	else if ( 0 == strcmp(key, "SWIM_TIMEOUT") ) {
+		SWIM_TIMEOUT = max(1, atoi(value));
+	}
+	else if ( 0 == strcmp(key, "SWIM_K") ) {
+		SWIM_K = max(0, atoi(value));
+	}
+	else if ( 0 == strcmp(key, "SWIM_SUSPECT") ) {
+		SWIM_SUSPECT = max(1, atoi(value));
+	}
+	else if ( 0 == strcmp(key, "JOIN_BATCH") ) {
+		JOIN_BATCH = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "FAILURE_DETECTOR") ) {
+		FAILURE_DETECTOR = (0 == strcmp(value, "PHI")) ? PHI_DETECTOR : FIXED_DETECTOR;
+	}
+	else if ( 0 == strcmp(key, "PHI_THRESHOLD") ) {
+		PHI_THRESHOLD = atof(value);
+	}
+	else if ( 0 == strcmp(key, "ACTIVE_VIEW") ) {
+		ACTIVE_VIEW = max(1, atoi(value));
+	}
+	else if ( 0 == strcmp(key, "PASSIVE_VIEW") ) {
+		PASSIVE_VIEW = max(1, atoi(value));
+	}
+	else if ( 0 == strcmp(key, "SHUFFLE_PERIOD") ) {
+		SHUFFLE_PERIOD = max(1, atoi(value));
+	}
+	else if ( 0 == strcmp(key, "SUSPICION") ) {
+		SUSPICION = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "STEP_RATE") ) {
+		STEP_RATE = atof(value);
+	}
+	else {
+		printf("Unknown parameter %s ignored\n", key);
+	}
+}
+
 /**
  * FUNCTION NAME: getcurrtime
  *
@@ -48,3 +220,12 @@ void Params::setparams(char *config_file) {
 int Params::getcurrtime(){
     return globaltime;
 }
+
+/**
+ * FUNCTION NAME: isLocal
+ *
+ * DESCRIPTION: Whether the node with this id runs in this process (see LOCAL_NODES)
+ */
+bool Params::isLocal(int id) {
+	return id >= LOCAL_FIRST && id <= LOCAL_LAST;
+}
@@ -13,6 +13,25 @@
 
 enum testTYPE { CREATE_TEST, READ_TEST, UPDATE_TEST, DELETE_TEST };
 
+// what EmulNet does with a message that would exceed EN_BUFFSIZE: drop it, or make room by
+// dropping the oldest message queued in its destination's inbox. Messages still held back
+// by link delay are not queued yet; when the destination has none queued, the new message
+// is dropped as with DROP_NEWEST.
+enum overflowPolicy { DROP_NEWEST, DROP_OLDEST_FOR_DEST };
+
+// network backend the nodes talk through
+enum transportType { EMULNET_TRANSPORT, UDP_TRANSPORT, URING_TRANSPORT };
+
+// what a heartbeat gossip round carries: the whole membership list, or what changed in the last few rounds,
+// repaired by periodic full lists or by comparing membership digests
+enum gossipMode { FULL_GOSSIP, DELTA_GOSSIP, DIGEST_GOSSIP };
+
+// failure detection: heartbeat gossip, SWIM probes with piggybacked updates, or HyParView partial views
+enum protocolType { GOSSIP_PROTOCOL, SWIM_PROTOCOL, HYPARVIEW_PROTOCOL };
+
+// when gossip gives up on a silent member: after TFAIL ticks, or once phi-accrual suspicion passes PHI_THRESHOLD
+enum failureDetector { FIXED_DETECTOR, PHI_DETECTOR };
+
 /**
  * CLASS NAME: Params
  *
@@ -31,9 +50,41 @@ public:
 	int globaltime;
 	int allNodesJoined;
 	short PORTNUM;
+	int MSGCOUNT_WINDOW;		// ticks of per-tick detail kept for msgcount.log
+	int EN_BUFFSIZE;			// max messages in flight, 0 for no bound
+	overflowPolicy EN_OVERFLOW;	// DROP_NEWEST or DROP_OLDEST_FOR_DEST, applied once EN_BUFFSIZE is reached
+	int LINK_DELAY;				// ticks every message spends in flight
+	int LINK_SPREAD;			// extra 0..LINK_SPREAD ticks, fixed per (from, to) link
+	int LINK_JITTER;			// extra 0..LINK_JITTER ticks, drawn per message
+	int THREADS;				// worker threads running the nodes each tick
+	transportType TRANSPORT;	// EMULNET, UDP or URING
+	int LOCAL_FIRST;			// ids of the nodes run by this process, from LOCAL_NODES
+	int LOCAL_LAST;
+	int TICK_USEC;				// wall-clock pause after every tick, 0 for none
+	unsigned long SEED;			// random streams of the run, from the clock unless given
+	string EN_TRACE;			// EmulNet capture file, empty for none
+	string EN_REPLAY;			// trace EmulNet replays instead of running the senders
+	gossipMode GOSSIP;			// FULL, DELTA or DIGEST
+	int FULL_SYNC_PERIOD;		// with DELTA, every this many rounds still sends the full list; DIGEST compares digests
+	int DELTA_ROUNDS;			// DELTA and DIGEST: gossip rounds an entry is sent in after it changes; 8, or 6 for DIGEST
+	int HEARTBEAT_EPOCH;		// ticks between a member's heartbeats, on multiples of it; DELTA and DIGEST default to 20
+	protocolType PROTOCOL;		// GOSSIP, SWIM or HYPARVIEW
+	int SWIM_PERIOD;			// ticks per SWIM probe; a target not acked by the end is suspected
+	int SWIM_TIMEOUT;			// ticks to wait for a direct ack before probing indirectly
+	int SWIM_K;					// members asked to probe indirectly
+	int SWIM_SUSPECT;			// ticks a suspected member has to refute it before it is declared failed
+	int JOIN_BATCH;				// 1: the introducer answers a tick's JOINREQs together
+	failureDetector FAILURE_DETECTOR;	// FIXED or PHI
+	double PHI_THRESHOLD;		// with PHI, suspicion at which a member counts as failed
+	int ACTIVE_VIEW;			// HYPARVIEW: neighbors each node keeps links to
+	int PASSIVE_VIEW;			// HYPARVIEW: backup members known for repairing the active view
+	int SHUFFLE_PERIOD;			// HYPARVIEW: ticks between shuffles of the passive view
+	int SUSPICION;				// GOSSIP: 1 spreads suspicions, refutations and removals on heartbeats
 	Params();
 	void setparams(char *);
+	void setparam(const char *key, const char *value);
 	int getcurrtime();
+	bool isLocal(int id);
 };
 
 #endif /* _PARAMS_H_ */
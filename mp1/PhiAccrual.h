@@ -0,0 +1,84 @@
+/**********************************
+ * FILE NAME: PhiAccrual.h
+ *
+ * DESCRIPTION: Phi-accrual suspicion from a member's recent heartbeat inter-arrival times
+ **********************************/
+
+#ifndef PHIACCRUAL_H_
+#define PHIACCRUAL_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// inter-arrival times kept per member
+#define PHI_WINDOW 16
+// arrivals needed before the window is trusted over the fixed timeout
+#define PHI_MIN_SAMPLES 8
+// floor on the standard deviation, in ticks; gossip that arrives like clockwork
+// would otherwise make a single late tick look certain
+#define PHI_MIN_STDDEV 0.5
+
+/**
+ * CLASS NAME: PhiAccrual
+ *
+ * DESCRIPTION: The last PHI_WINDOW gaps between heartbeat arrivals, one byte each, fitted
+ * 				with a normal distribution. phi(t) = -log10 P(the next heartbeat is later
+ * 				than t ticks) grows with the silence; a member is suspected once it passes
+ * 				the threshold. The threshold is fixed for a run, so the silence that crosses
+ * 				it only changes when a heartbeat arrives and is worked out then.
+ */
+class PhiAccrual {
+private:
+	unsigned char gaps[PHI_WINDOW];
+	unsigned char count;
+	unsigned char next;
+	// suspectAfter's last answer, -1 once an arrival has made it stale
+	short cached;
+public:
+	PhiAccrual(): count(0), next(0), cached(-1) {}
+
+	// Record a heartbeat that came gap ticks after the previous one
+	void arrival(int gap) {
+		gaps[next] = (unsigned char)min(max(gap, 0), (int)UCHAR_MAX);
+		next = (next + 1) % PHI_WINDOW;
+		if ( count < PHI_WINDOW ) {
+			count++;
+		}
+		cached = -1;
+	}
+
+	// Suspicion after elapsed ticks without a heartbeat
+	double phi(int elapsed) const {
+		double mean = 0, var = 0;
+		for ( int i = 0; i < count; i++ ) {
+			mean += gaps[i];
+		}
+		mean /= count;
+		for ( int i = 0; i < count; i++ ) {
+			var += (gaps[i] - mean) * (gaps[i] - mean);
+		}
+		double sd = max(sqrt(var / count), PHI_MIN_STDDEV);
+		double later = 0.5 * erfc((elapsed - mean) / (sd * M_SQRT2));
+		return later > 0 ? -log10(later) : HUGE_VAL;
+	}
+
+	// Most ticks of silence that keep phi within threshold, at most limit; fallback until
+	// the window has PHI_MIN_SAMPLES arrivals
+	int suspectAfter(double threshold, int fallback, int limit) {
+		if ( count < PHI_MIN_SAMPLES ) {
+			return fallback;
+		}
+		if ( cached < 0 ) {
+			int t = 0;
+			while ( t < limit && phi(t + 1) <= threshold ) {
+				t++;
+			}
+			cached = (short)t;
+		}
+		return cached;
+	}
+};
+
+#endif /* PHIACCRUAL_H_ */
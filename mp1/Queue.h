@@ -1,7 +1,7 @@
 /**********************************
  * FILE NAME: Queue.h
  *
- * DESCRIPTION: Header file for std::<queue> related functions
+ * DESCRIPTION: Header file for queue related functions
  **********************************/
 
 #ifndef QUEUE_H_
@@ -13,15 +13,15 @@
 /**
  * Class name: Queue
  *
- * Description: This function wraps std::queue related functions
+ * Description: This function wraps RingBuffer queue related functions
  */
 class Queue {
 public:
 	Queue() {}
 	virtual ~Queue() {}
-	static bool enqueue(queue<q_elt> *queue, void *buffer, int size) {
+	static bool enqueue(RingBuffer<q_elt> *queue, void *buffer, int size) {
 		q_elt element(buffer, size);
-		queue->emplace(element);
+		queue->push_back(element);
 		return true;
 	}
 };
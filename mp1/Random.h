@@ -0,0 +1,71 @@
+/**********************************
+ * FILE NAME: Random.h
+ *
+ * DESCRIPTION: Seedable random number streams
+ **********************************/
+
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// stream numbers; node n draws from RNG_STREAM_NODE + n, and EmulNet decides the fate of
+// the messages to node n from RNG_STREAM_INBOX + n
+#define RNG_STREAM_NET 0
+#define RNG_STREAM_APP 1
+#define RNG_STREAM_NODE 2
+#define RNG_STREAM_INBOX (1ULL << 32)
+
+/**
+ * CLASS NAME: Random
+ *
+ * DESCRIPTION: xoshiro256** generator. Every (seed, stream) pair gives an independent
+ * 				sequence, so each node and the network own a stream and draw without
+ * 				sharing state, and a run is reproduced exactly by reusing its SEED.
+ */
+class Random {
+private:
+	uint64_t s[4];
+	static uint64_t rotl(uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+	static uint64_t splitmix64(uint64_t &x) {
+		uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+public:
+	Random() {
+		seed(0, 0);
+	}
+	Random(uint64_t seed, uint64_t stream) {
+		this->seed(seed, stream);
+	}
+	void seed(uint64_t seed, uint64_t stream) {
+		uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+		for ( int i = 0; i < 4; i++ ) {
+			s[i] = splitmix64(x);
+		}
+	}
+	uint64_t next() {
+		uint64_t result = rotl(s[1] * 5, 7) * 9;
+		uint64_t t = s[1] << 17;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+		return result;
+	}
+	// Uniform in [0, n), n > 0
+	int below(int n) {
+		return (int)(((next() >> 32) * (uint64_t)n) >> 32);
+	}
+};
+
+#endif /* RANDOM_H_ */
@@ -0,0 +1,65 @@
+/**********************************
+ * FILE NAME: RingBuffer.h
+ *
+ * DESCRIPTION: Growable FIFO ring buffer
+ **********************************/
+
+#ifndef RINGBUFFER_H_
+#define RINGBUFFER_H_
+
+#include "stdincludes.h"
+
+/**
+ * CLASS NAME: RingBuffer
+ *
+ * DESCRIPTION: FIFO queue over a power-of-two circular array. Storage only grows when
+ * 				the queue is fuller than it has ever been, so a queue that is pushed and
+ * 				drained every tick stops allocating once it reaches its high-water mark.
+ */
+template <typename T>
+class RingBuffer {
+private:
+	vector<T> buf;
+	size_t head;
+	size_t count;
+	void grow() {
+		size_t capacity = buf.empty() ? 16 : buf.size() * 2;
+		vector<T> bigger(capacity);
+		for ( size_t i = 0; i < count; i++ ) {
+			bigger[i] = buf[(head + i) & (buf.size() - 1)];
+		}
+		buf.swap(bigger);
+		head = 0;
+	}
+public:
+	RingBuffer(): head(0), count(0) {}
+	bool empty() const {
+		return count == 0;
+	}
+	size_t size() const {
+		return count;
+	}
+	size_t capacity() const {
+		return buf.size();
+	}
+	T& front() {
+		return buf[head];
+	}
+	void push_back(const T &elt) {
+		if ( count == buf.size() ) {
+			grow();
+		}
+		buf[(head + count) & (buf.size() - 1)] = elt;
+		count++;
+	}
+	void pop_front() {
+		head = (head + 1) & (buf.size() - 1);
+		count--;
+	}
+	void clear() {
+		head = 0;
+		count = 0;
+	}
+};
+
+#endif /* RINGBUFFER_H_ */
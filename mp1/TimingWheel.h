@@ -0,0 +1,110 @@
+/**********************************
+ * FILE NAME: TimingWheel.h
+ *
+ * DESCRIPTION: Hashed timing wheel keyed on simulation ticks
+ **********************************/
+
+#ifndef TIMINGWHEEL_H_
+#define TIMINGWHEEL_H_
+
+#include "stdincludes.h"
+
+/**
+ * CLASS NAME: TimingWheel
+ *
+ * DESCRIPTION: Holds items until the tick they are due. Slot (tick & mask) collects the
+ * 				items due at that tick; the wheel always has more slots than the furthest
+ * 				deadline it holds, so a slot never mixes ticks and advancing only visits
+ * 				the slots that have come due. Scheduling and expiring are O(1) per item.
+ */
+template <typename T>
+class TimingWheel {
+private:
+	struct Timer {
+		int due;
+		T item;
+	};
+	vector< vector<Timer> > slots;
+	// scratch space for the slot being fired
+	vector<Timer> fired;
+	// every tick before this one has been expired
+	int now;
+	size_t pending;
+	void grow(int span) {
+		size_t capacity = slots.empty() ? 16 : slots.size();
+		while ( capacity <= (size_t)span ) {
+			capacity *= 2;
+		}
+		vector< vector<Timer> > bigger(capacity);
+		for ( size_t i = 0; i < slots.size(); i++ ) {
+			for ( size_t j = 0; j < slots[i].size(); j++ ) {
+				bigger[slots[i][j].due & (capacity - 1)].push_back(slots[i][j]);
+			}
+		}
+		slots.swap(bigger);
+	}
+public:
+	TimingWheel(): now(0), pending(0) {}
+	size_t size() const {
+		return pending;
+	}
+	int getNow() const {
+		return now;
+	}
+	/**
+	 * Queue item until tick due. Items due in the past fire on the next advance.
+	 */
+	void schedule(int due, const T &item) {
+		if ( due < now ) {
+			due = now;
+		}
+		if ( (size_t)(due - now) >= slots.size() ) {
+			grow(due - now);
+		}
+		Timer timer;
+		timer.due = due;
+		timer.item = item;
+		slots[due & (slots.size() - 1)].push_back(timer);
+		pending++;
+	}
+	/**
+	 * Hand every item due before tick until to fire(item), in deadline order and in
+	 * scheduling order within a tick.
+	 */
+	template <typename F>
+	void advance(int until, F fire) {
+		if ( until <= now ) {
+			return;
+		}
+		for ( int tick = now; tick < until && pending > 0; tick++ ) {
+			vector<Timer> &slot = slots[tick & (slots.size() - 1)];
+			if ( slot.empty() ) {
+				continue;
+			}
+			// fire may schedule (and grow the wheel); move the slot out of the way first
+			now = tick + 1;
+			fired.swap(slot);
+			for ( size_t i = 0; i < fired.size(); i++ ) {
+				pending--;
+				fire(fired[i].item);
+			}
+			fired.clear();
+		}
+		now = until;
+	}
+	/**
+	 * Hand every pending item to fire(item) regardless of its deadline
+	 */
+	template <typename F>
+	void drain(F fire) {
+		for ( size_t i = 0; i < slots.size(); i++ ) {
+			for ( size_t j = 0; j < slots[i].size(); j++ ) {
+				fire(slots[i][j].item);
+			}
+			slots[i].clear();
+		}
+		pending = 0;
+	}
+};
+
+#endif /* TIMINGWHEEL_H_ */
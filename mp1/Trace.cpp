@@ -0,0 +1,84 @@
+/**********************************
+ * FILE NAME: Trace.cpp
+ *
+ * DESCRIPTION: Definition of the Trace class
+ **********************************/
+
+#include "Trace.h"
+
+atomic<unsigned long> Trace::next(0);
+
+/**
+ * FUNCTION NAME: ring
+ *
+ * DESCRIPTION: The event ring, allocated by the first event so untraced builds never pay for it
+ */
+TraceEvent *Trace::ring() {
+	static vector<TraceEvent> events(TRACE_RING_SIZE);
+	return &events[0];
+}
+
+/**
+ * FUNCTION NAME: record
+ *
+ * DESCRIPTION: Claim the next slot of the ring and fill it in. Safe from any worker thread:
+ * 				after the ring wraps, two threads can be handed the same slot, and the one
+ * 				that finds it TRACE_BUSY drops its event instead of tearing the other's.
+ */
+void Trace::record(const char *what, long arg, int level, int category, traceKind kind) {
+	unsigned long n = next.fetch_add(1, memory_order_relaxed);
+	TraceEvent &e = ring()[n & (TRACE_RING_SIZE - 1)];
+	if ( e.seq.exchange(TRACE_BUSY, memory_order_acquire) == TRACE_BUSY ) {
+		return;
+	}
+	e.tick = par ? par->getcurrtime() : 0;
+	e.node = node;
+	e.what = what;
+	e.arg = arg;
+	e.level = (unsigned char)level;
+	e.category = (unsigned char)category;
+	e.kind = (unsigned char)kind;
+	e.seq.store(n + 1, memory_order_release);
+}
+
+/**
+ * FUNCTION NAME: dump
+ *
+ * DESCRIPTION: Write the events still in the ring to file, oldest first. A slot whose seq
+ * 				is not the event expected there was dropped or overwritten out of order, and
+ * 				is counted at the end instead. Does nothing if none were recorded.
+ */
+void Trace::dump(const char *file) {
+	unsigned long end = next.load();
+	if ( end == 0 ) {
+		return;
+	}
+	FILE *out = fopen(file, "w");
+	if ( NULL == out ) {
+		printf("Unable to write trace file %s\n", file);
+		return;
+	}
+	unsigned long begin = end > TRACE_RING_SIZE ? end - TRACE_RING_SIZE : 0;
+	unsigned long lost = 0;
+	for ( unsigned long i = begin; i < end; i++ ) {
+		TraceEvent &e = ring()[i & (TRACE_RING_SIZE - 1)];
+		if ( e.seq.load(memory_order_acquire) != i + 1 ) {
+			lost++;
+			continue;
+		}
+		fprintf(out, "%d [%d] L%d C%02x ", e.tick, e.node, e.level, e.category);
+		if ( e.kind == TRACE_ENTRY ) {
+			fprintf(out, "> %s\n", e.what);
+		}
+		else if ( e.kind == TRACE_EXIT ) {
+			fprintf(out, "< %s = %ld\n", e.what, e.arg);
+		}
+		else {
+			fprintf(out, "%s %ld\n", e.what, e.arg);
+		}
+	}
+	if ( lost ) {
+		fprintf(out, "%lu events lost to concurrent writes\n", lost);
+	}
+	fclose(out);
+}
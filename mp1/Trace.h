@@ -0,0 +1,131 @@
+/**********************************
+ * FILE NAME: Trace.h
+ *
+ * DESCRIPTION: Levelled, categorised tracing of the protocol code that compiles away
+ * 				unless it is asked for at build time
+ **********************************/
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+#include "Member.h"
+#include <atomic>
+#include <type_traits>
+
+/*
+ * Macros
+ */
+// most detailed level built in; 0 builds every trace call as a no-op.
+// e.g. make TRACE="-DTRACE_LEVEL=3 -DTRACE_CATEGORIES=TRACE_JOIN"
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL 0
+#endif
+// traceCategory bits built in
+#ifndef TRACE_CATEGORIES
+#define TRACE_CATEGORIES TRACE_ALL
+#endif
+// events the ring keeps, a power of two; older ones are overwritten
+#define TRACE_RING_SIZE (1 << 16)
+#define TRACE_LOG "trace.log"
+// TraceEvent::seq of a slot being written
+#define TRACE_BUSY (~0UL)
+
+enum traceLevel { TRACE_ERROR = 1, TRACE_INFO, TRACE_DEBUG };
+enum traceCategory { TRACE_JOIN = 1, TRACE_GOSSIP = 2, TRACE_MEMBERS = 4, TRACE_SWIM = 8, TRACE_HYPARVIEW = 16, TRACE_ALL = 0xff };
+enum traceKind { TRACE_ENTRY, TRACE_EXIT, TRACE_EVENT };
+
+/**
+ * STRUCT NAME: TraceEvent
+ *
+ * DESCRIPTION: One slot of the trace ring. Nothing is formatted when an event is recorded;
+ * 				what is a string literal and the ring keeps only the pointer. seq is the
+ * 				number of the event the slot holds plus one, TRACE_BUSY while a thread is
+ * 				writing it; once the ring wraps, an event whose slot is still being written
+ * 				is dropped rather than written over it.
+ */
+typedef struct TraceEvent {
+	atomic<unsigned long> seq;
+	int tick;
+	int node;
+	const char *what;
+	long arg;
+	unsigned char level;
+	unsigned char category;
+	unsigned char kind;
+}TraceEvent;
+
+/**
+ * CLASS NAME: Trace
+ *
+ * DESCRIPTION: A node's handle on the process-wide trace ring. Whether a call records
+ * 				anything is decided from its template arguments at compile time, so with
+ * 				TRACE_LEVEL 0 or the category masked out it is an empty inline call.
+ * 				Recorded events are written out as text by dump() at the end of the run.
+ */
+class Trace {
+private:
+	Params *par;
+	int node;
+	static atomic<unsigned long> next;
+	static TraceEvent *ring();
+	void record(const char *what, long arg, int level, int category, traceKind kind);
+	void emit(const char *, long, int, int, traceKind, false_type) {}
+	void emit(const char *what, long arg, int level, int category, traceKind kind, true_type) {
+		record(what, arg, level, category, kind);
+	}
+public:
+	Trace(): par(NULL), node(0) {}
+	void bind(Params *par, Address *addr) {
+		this->par = par;
+		this->node = NodeId(*addr).getid();
+	}
+	static constexpr bool enabled(int level, int category) {
+		return level <= TRACE_LEVEL && (category & (TRACE_CATEGORIES)) != 0;
+	}
+	template <int level, int category>
+	void event(const char *what, long arg) {
+		emit(what, arg, level, category, TRACE_EVENT, integral_constant<bool, enabled(level, category)>());
+	}
+	template <int category>
+	void funcEntry(const char *func) {
+		emit(func, 0, TRACE_DEBUG, category, TRACE_ENTRY, integral_constant<bool, enabled(TRACE_DEBUG, category)>());
+	}
+	template <int category>
+	void funcExit(const char *func, long result) {
+		emit(func, result, TRACE_DEBUG, category, TRACE_EXIT, integral_constant<bool, enabled(TRACE_DEBUG, category)>());
+	}
+	static void dump(const char *file);
+};
+
+/**
+ * CLASS NAME: TraceScope
+ *
+ * DESCRIPTION: Records a function's entry when constructed and its exit when it goes out
+ * 				of scope, so every return path is paired. result() sets the value the exit
+ * 				carries, SUCCESS unless set, and passes it through: return scope.result(x);
+ */
+template <int category>
+class TraceScope {
+private:
+	Trace &trace;
+	const char *func;
+	long res;
+	TraceScope(const TraceScope &);
+	TraceScope& operator =(const TraceScope &);
+public:
+	TraceScope(Trace &trace, const char *func): trace(trace), func(func), res(SUCCESS) {
+		trace.funcEntry<category>(func);
+	}
+	~TraceScope() {
+		trace.funcExit<category>(func, res);
+	}
+	template <typename T>
+	T result(T value) {
+		res = (long)value;
+		return value;
+	}
+};
+
+#endif /* TRACE_H_ */
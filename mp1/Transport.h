@@ -0,0 +1,52 @@
+/**********************************
+ * FILE NAME: Transport.h
+ *
+ * DESCRIPTION: Interface shared by the emulated and the real network backends
+ **********************************/
+
+#ifndef TRANSPORT_H_
+#define TRANSPORT_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+
+/**
+ * CLASS NAME: Transport
+ *
+ * DESCRIPTION: What MP1Node and Application need from a network. Buffers handed to enq
+ * 				by ENrecv belong to the transport and go back through ENrelease.
+ *
+ * 				ENsend copies the message. A message for several destinations can instead
+ * 				be written once into a buffer from ENalloc and passed to ENsendShared for
+ * 				each of them; the transport takes its own reference every time, and the
+ * 				sender gives its reference back with ENrelease when it is done with it.
+ *
+ * 				A node's outgoing messages may be held back until ENcommit is called for
+ * 				it; Application commits every node after running it. The remaining hooks
+ * 				only matter to backends that support THREADS > 1.
+ */
+class Transport {
+public:
+	virtual ~Transport() {}
+	virtual void *ENinit(Address *myaddr, short port) = 0;
+	virtual int ENsend(Address *myaddr, Address *toaddr, string data) = 0;
+	virtual int ENsend(Address *myaddr, Address *toaddr, char *data, int size) = 0;
+	virtual int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue) = 0;
+	virtual void ENrelease(char *data) = 0;
+	virtual char *ENalloc(int size) = 0;
+	virtual int ENsendShared(Address *myaddr, Address *toaddr, char *data, int size) = 0;
+	virtual int ENcommit(Address *myaddr) = 0;
+	virtual int ENcleanup() = 0;
+	// Make the calling thread use per-thread state number shard
+	virtual void ENbind(int) {}
+	// Tell the backend that nodes are about to run concurrently (or no longer are)
+	virtual void ENstage(bool) {}
+	// Do the once-per-tick receive work up front, before several threads call ENrecv
+	virtual void ENdeliver() {}
+	// Shards the staged messages can be routed in, one thread each, before the nodes are
+	// committed; 0 if ENcommit has to route them itself
+	virtual int ENshards() { return 0; }
+	virtual void ENcommitShard(int) {}
+};
+
+#endif /* TRANSPORT_H_ */
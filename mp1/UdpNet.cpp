@@ -0,0 +1,390 @@
+/**********************************
+ * FILE NAME: UdpNet.cpp
+ *
+ * DESCRIPTION: Loopback UDP network classes definition
+ **********************************/
+
+#include "UdpNet.h"
+
+// Message pool used by the calling thread, see ENbind
+static thread_local int udpShard = 0;
+
+/**
+ * Constructor
+ */
+UdpNet::UdpNet(Params *p): par(p), nextid(1), lastPollTick(-1), probDrops(0), oversizeDrops(0), sendErrors(0), syscalls(0) {
+	rng.seed(par->SEED, RNG_STREAM_NET);
+	epfd = epoll_create1(0);
+	if ( epfd < 0 ) {
+		perror("epoll_create1");
+		exit(1);
+	}
+	for ( int i = 0; i < par->THREADS; i++ ) {
+		pools.push_back(new MsgPool());
+	}
+}
+
+/**
+ * Destructor
+ */
+UdpNet::~UdpNet() {
+	for ( size_t i = 0; i < nodes.size(); i++ ) {
+		for ( size_t j = 0; j < nodes[i].pending.size(); j++ ) {
+			ENrelease(nodes[i].pending[j].data);
+		}
+		if ( nodes[i].fd >= 0 ) {
+			close(nodes[i].fd);
+		}
+	}
+	if ( epfd >= 0 ) {
+		close(epfd);
+	}
+	for ( size_t i = 0; i < pools.size(); i++ ) {
+		delete pools[i];
+	}
+}
+
+/**
+ * FUNCTION NAME: getNode
+ *
+ * DESCRIPTION: Socket state of the node with this address
+ */
+UdpNode *UdpNet::getNode(Address *addr) {
+	int id = NodeId(*addr).getid();
+	assert(id > 0 && id < (int)nodes.size());
+	return &nodes[id];
+}
+
+/**
+ * FUNCTION NAME: getMsgCount
+ *
+ * DESCRIPTION: Accounting record of the given node, created on first use
+ */
+MsgCount& UdpNet::getMsgCount(int id) {
+	assert(id >= 0);
+	if ( id >= (int)msgcount.size() ) {
+		msgcount.resize(id + 1);
+	}
+	return msgcount[id];
+}
+
+/**
+ * FUNCTION NAME: toSockaddr
+ *
+ * DESCRIPTION: Map an Address to the loopback socket address serving it
+ */
+void UdpNet::toSockaddr(Address *addr, struct sockaddr_in *sa) {
+	int id = NodeId(*addr).getid();
+	unsigned short port = *(unsigned short *)(&addr->addr[4]);
+
+	memset(sa, 0, sizeof(*sa));
+	sa->sin_family = AF_INET;
+	sa->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sa->sin_port = htons(port != 0 ? port : (unsigned short)(par->PORTNUM + id));
+}
+
+/**
+ * FUNCTION NAME: dropOnSend
+ *
+ * DESCRIPTION: Decide, the way EmulNet does, whether this message is lost instead of sent
+ */
+bool UdpNet::dropOnSend(en_msg &em) {
+	int sendmsg = rng.below(100);
+	if ( em.size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE ) {
+		oversizeDrops++;
+		return true;
+	}
+	if ( par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100) ) {
+		probDrops++;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: ENinit
+ *
+ * DESCRIPTION: Assign the next id and, if the node runs in this process, open its socket
+ */
+void *UdpNet::ENinit(Address *myaddr, short) {
+	struct sockaddr_in sa;
+	struct epoll_event ev;
+	UdpNode node;
+
+	int id = nextid++;
+	*myaddr = Address(NodeId(id, 0));
+
+	node.fd = -1;
+	node.readable = false;
+	if ( id >= par->LOCAL_FIRST && id <= par->LOCAL_LAST ) {
+		node.fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+		toSockaddr(myaddr, &sa);
+		if ( node.fd < 0 || bind(node.fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 ) {
+			perror("UdpNet::ENinit");
+			exit(1);
+		}
+		ev.events = EPOLLIN;
+		ev.data.u32 = id;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, node.fd, &ev);
+		events.push_back(ev);
+	}
+
+	if ( id >= (int)nodes.size() ) {
+		nodes.resize(id + 1);
+	}
+	nodes[id] = node;
+	getMsgCount(id);
+	return myaddr;
+}
+
+/**
+ * FUNCTION NAME: ENsend
+ *
+ * DESCRIPTION: Queue a message; it leaves with the rest of the sender's batch on ENcommit
+ *
+ * RETURNS:
+ * size
+ */
+int UdpNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
+	en_msg em;
+
+	em.size = size;
+	em.from = *myaddr;
+	em.to = *toaddr;
+	em.data = pools[udpShard]->acquire(size);
+	memcpy(em.data, data, size);
+
+	getNode(myaddr)->pending.push_back(em);
+	return size;
+}
+
+/**
+ * FUNCTION NAME: ENsend
+ *
+ * DESCRIPTION: UdpNet send function
+ *
+ * RETURNS:
+ * size
+ */
+int UdpNet::ENsend(Address *myaddr, Address *toaddr, string data) {
+	return this->ENsend(myaddr, toaddr, (char *)data.data(), (data.length() * sizeof(char)));
+}
+
+/**
+ * FUNCTION NAME: ENcommit
+ *
+ * DESCRIPTION: Send this node's queued messages, UDP_BATCH datagrams per sendmmsg call.
+ * 				MSG_DROP_PROB and MAX_MSG_SIZE are applied as in EmulNet.
+ *
+ * RETURNS:
+ * number of messages handed to the kernel
+ */
+int UdpNet::ENcommit(Address *myaddr) {
+	struct mmsghdr msgs[UDP_BATCH];
+	struct iovec iov[UDP_BATCH];
+	struct sockaddr_in dest[UDP_BATCH];
+	UdpNode *node = getNode(myaddr);
+	int total = (int)node->pending.size();
+	int sent = 0;
+	int time = par->getcurrtime();
+	MsgCount &count = getMsgCount(NodeId(*myaddr).getid());
+
+	int i = 0;
+	while ( i < total ) {
+		int n = 0;
+		for ( ; i < total && n < UDP_BATCH; i++ ) {
+			en_msg &em = node->pending[i];
+			if ( dropOnSend(em) ) {
+				continue;
+			}
+			toSockaddr(&em.to, &dest[n]);
+			iov[n].iov_base = em.data;
+			iov[n].iov_len = em.size;
+			memset(&msgs[n], 0, sizeof(msgs[n]));
+			msgs[n].msg_hdr.msg_name = &dest[n];
+			msgs[n].msg_hdr.msg_namelen = sizeof(dest[n]);
+			msgs[n].msg_hdr.msg_iov = &iov[n];
+			msgs[n].msg_hdr.msg_iovlen = 1;
+			n++;
+		}
+
+		int done = 0;
+		while ( done < n ) {
+			int ret = sendmmsg(node->fd, msgs + done, n - done, MSG_DONTWAIT);
+			syscalls++;
+			if ( ret <= 0 ) {
+				// the socket buffer is full; a real network would lose these too
+				sendErrors += n - done;
+				break;
+			}
+			for ( int k = 0; k < ret; k++ ) {
+				count.countSent(time, par->MSGCOUNT_WINDOW, msgs[done + k].msg_len);
+			}
+			done += ret;
+			sent += ret;
+		}
+	}
+
+	for ( i = 0; i < total; i++ ) {
+		ENrelease(node->pending[i].data);
+	}
+	node->pending.clear();
+	return sent;
+}
+
+/**
+ * FUNCTION NAME: poll
+ *
+ * DESCRIPTION: Find the sockets with datagrams waiting, without blocking. The sockets are
+ * 				level-triggered, so a second call would only report the same ones again;
+ * 				events has room for all of them and one call is enough.
+ */
+void UdpNet::poll() {
+	lastPollTick = par->getcurrtime();
+	if ( events.empty() ) {
+		return;
+	}
+
+	int n = epoll_wait(epfd, events.data(), (int)events.size(), 0);
+	syscalls++;
+	for ( int i = 0; i < n; i++ ) {
+		nodes[events[i].data.u32].readable = true;
+	}
+}
+
+/**
+ * FUNCTION NAME: ENdeliver
+ *
+ * DESCRIPTION: Poll the sockets for this tick
+ */
+void UdpNet::ENdeliver() {
+	if ( lastPollTick != par->getcurrtime() ) {
+		poll();
+	}
+}
+
+/**
+ * FUNCTION NAME: ENrecv
+ *
+ * DESCRIPTION: Drain this node's socket, UDP_BATCH datagrams per recvmmsg call, directly
+ * 				into pooled buffers that the receiver releases with ENrelease
+ *
+ * RETURN:
+ * 0
+ */
+int UdpNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *, int, void *queue) {
+	struct mmsghdr msgs[UDP_BATCH];
+	struct iovec iov[UDP_BATCH];
+	char *bufs[UDP_BATCH];
+	UdpNode *node = getNode(myaddr);
+	MsgCount &count = getMsgCount(NodeId(*myaddr).getid());
+	MsgPool *pool = pools[udpShard];
+	int time = par->getcurrtime();
+	int i, n;
+
+	ENdeliver();
+	if ( !node->readable ) {
+		return 0;
+	}
+	node->readable = false;
+
+	do {
+		for ( i = 0; i < UDP_BATCH; i++ ) {
+			bufs[i] = pool->acquire(par->MAX_MSG_SIZE);
+			iov[i].iov_base = bufs[i];
+			iov[i].iov_len = par->MAX_MSG_SIZE;
+			memset(&msgs[i], 0, sizeof(msgs[i]));
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		n = recvmmsg(node->fd, msgs, UDP_BATCH, MSG_DONTWAIT, NULL);
+		syscalls++;
+		for ( i = 0; i < UDP_BATCH; i++ ) {
+			if ( i < n ) {
+				(*enq)(queue, bufs[i], msgs[i].msg_len);
+				count.countRecv(time, par->MSGCOUNT_WINDOW, msgs[i].msg_len);
+			}
+			else {
+				pool->release(bufs[i]);
+			}
+		}
+	} while ( n == UDP_BATCH );
+
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: ENrelease
+ *
+ * DESCRIPTION: Return a buffer handed out by ENrecv once the receiver is done with it
+ */
+void UdpNet::ENrelease(char *data) {
+	pools[udpShard]->release(data);
+}
+
+/**
+ * FUNCTION NAME: ENalloc
+ *
+ * DESCRIPTION: A pooled buffer for ENsendShared, released with ENrelease
+ */
+char *UdpNet::ENalloc(int size) {
+	return pools[udpShard]->acquire(size);
+}
+
+/**
+ * FUNCTION NAME: ENsendShared
+ *
+ * DESCRIPTION: Queue a buffer from ENalloc without copying it; the queued message holds
+ * 				its own reference until ENcommit has sent it
+ *
+ * RETURNS:
+ * size
+ */
+int UdpNet::ENsendShared(Address *myaddr, Address *toaddr, char *data, int size) {
+	en_msg em;
+
+	em.size = size;
+	em.from = *myaddr;
+	em.to = *toaddr;
+	em.data = data;
+	MsgPool::retain(data);
+
+	getNode(myaddr)->pending.push_back(em);
+	return size;
+}
+
+/**
+ * FUNCTION NAME: ENbind
+ *
+ * DESCRIPTION: Make the calling thread allocate from and release to message pool shard
+ */
+void UdpNet::ENbind(int shard) {
+	udpShard = shard % (int)pools.size();
+}
+
+/**
+ * FUNCTION NAME: ENcleanup
+ *
+ * DESCRIPTION: Close the sockets and write msgcount.log. Called exactly once at the end of the program.
+ */
+int UdpNet::ENcleanup() {
+	FILE* file = fopen("msgcount.log", "w+");
+
+	for ( size_t i = 0; i < nodes.size(); i++ ) {
+		if ( nodes[i].fd >= 0 ) {
+			epoll_ctl(epfd, EPOLL_CTL_DEL, nodes[i].fd, NULL);
+			close(nodes[i].fd);
+			nodes[i].fd = -1;
+		}
+	}
+
+	// every node gets a line, including one that never sent or received
+	getMsgCount(par->EN_GPSZ);
+	MsgCount::logAll(file, msgcount, par);
+
+	fprintf(file, "dropped probabilistic %ld  oversize %ld  send_errors %ld  syscalls %ld\n", probDrops, oversizeDrops, sendErrors, syscalls);
+
+	fclose(file);
+	return 0;
+}
@@ -0,0 +1,95 @@
+/**********************************
+ * FILE NAME: UdpNet.h
+ *
+ * DESCRIPTION: Loopback UDP network classes header file
+ **********************************/
+
+#ifndef UDPNET_H_
+#define UDPNET_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+#include "Member.h"
+#include "MsgPool.h"
+#include "EmulNet.h"
+#include "Transport.h"
+#include "Random.h"
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*
+ * Macros
+ */
+// datagrams moved per sendmmsg/recvmmsg call
+#define UDP_BATCH 64
+
+/**
+ * STRUCT NAME: UdpNode
+ *
+ * DESCRIPTION: Socket and pending output of one local node
+ */
+typedef struct UdpNode {
+	int fd;
+	// set by the once-per-tick epoll poll, cleared once ENrecv drained the socket
+	bool readable;
+	// messages sent since the last ENcommit, in pooled buffers
+	vector<en_msg> pending;
+}UdpNode;
+
+/**
+ * CLASS NAME: UdpNet
+ *
+ * DESCRIPTION: Real network backend. Every node gets a non-blocking UDP socket on
+ * 				127.0.0.1. An Address (id, port) maps to 127.0.0.1:port; emulated addresses
+ * 				carry port 0, and those map to 127.0.0.1:(PORTNUM + id) so that nodes in
+ * 				one or several processes on the same host do not collide.
+ *
+ * 				Sends are batched per node and go out with sendmmsg when the node is
+ * 				committed. One epoll_wait per tick finds all the readable sockets and ENrecv
+ * 				drains those with recvmmsg straight into pooled buffers.
+ */
+class UdpNet : public Transport
+{
+private:
+	UdpNet(const UdpNet &anotherUdpNet);
+	UdpNet& operator =(const UdpNet &anotherUdpNet);
+	void poll();
+protected:
+	Params* par;
+	int nextid;
+	int epfd;
+	int lastPollTick;
+	vector<UdpNode> nodes;
+	// room for every local socket, so one epoll_wait sees them all
+	vector<struct epoll_event> events;
+	vector<MsgPool *> pools;
+	vector<MsgCount> msgcount;
+	long probDrops;
+	long oversizeDrops;
+	long sendErrors;
+	long syscalls;
+	// drop decisions
+	Random rng;
+	UdpNode *getNode(Address *addr);
+	MsgCount& getMsgCount(int id);
+	void toSockaddr(Address *addr, struct sockaddr_in *sa);
+	bool dropOnSend(en_msg &em);
+public:
+	UdpNet(Params *p);
+	virtual ~UdpNet();
+	void *ENinit(Address *myaddr, short port);
+	int ENsend(Address *myaddr, Address *toaddr, string data);
+	int ENsend(Address *myaddr, Address *toaddr, char *data, int size);
+	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
+	void ENrelease(char *data);
+	char *ENalloc(int size);
+	int ENsendShared(Address *myaddr, Address *toaddr, char *data, int size);
+	int ENcommit(Address *myaddr);
+	void ENbind(int shard);
+	void ENdeliver();
+	int ENcleanup();
+};
+
+#endif /* UDPNET_H_ */
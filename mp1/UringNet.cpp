@@ -0,0 +1,468 @@
+/**********************************
+ * FILE NAME: UringNet.cpp
+ *
+ * DESCRIPTION: io_uring network classes definition
+ **********************************/
+
+#include "UringNet.h"
+
+// Freed-buffer list used by the calling thread, see ENbind
+static thread_local int uringShard = 0;
+
+/**
+ * Constructor
+ */
+UringNet::UringNet(Params *p): UdpNet(p), ringfd(-1), sqRing(MAP_FAILED), sqes((struct io_uring_sqe *)MAP_FAILED), sqQueued(0),
+		cqRing(MAP_FAILED), bufBase((char *)MAP_FAILED), lastReapTick(-1),
+		cqeCount(0), bufExhausted(0), backlogDrops(0), sendsInFlight(0) {
+	freed.resize(par->THREADS);
+	uring = setup();
+	if ( !uring ) {
+		printf("io_uring unavailable, UringNet falls back to sendmmsg/recvmmsg\n");
+	}
+}
+
+/**
+ * Destructor
+ */
+UringNet::~UringNet() {
+	teardown();
+}
+
+/**
+ * FUNCTION NAME: setup
+ *
+ * DESCRIPTION: Create the ring, map its queues and provide the receive buffers
+ *
+ * RETURNS:
+ * true if io_uring can be used
+ */
+bool UringNet::setup() {
+	struct io_uring_params p;
+
+	if ( URING_BUF_SIZE < par->MAX_MSG_SIZE ) {
+		return false;
+	}
+
+	memset(&p, 0, sizeof(p));
+	// every receive completion holds a buffer, so this many can never overflow
+	p.flags = IORING_SETUP_CQSIZE;
+	p.cq_entries = 2 * URING_BUFS;
+	ringfd = (int) syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+	if ( ringfd < 0 ) {
+		return false;
+	}
+
+	sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if ( p.features & IORING_FEAT_SINGLE_MMAP ) {
+		sqRingSize = cqRingSize = max(sqRingSize, cqRingSize);
+	}
+	sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd, IORING_OFF_SQ_RING);
+	if ( sqRing == MAP_FAILED ) {
+		teardown();
+		return false;
+	}
+	if ( p.features & IORING_FEAT_SINGLE_MMAP ) {
+		cqRing = sqRing;
+	}
+	else {
+		cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd, IORING_OFF_CQ_RING);
+	}
+	sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+	sqes = (struct io_uring_sqe *) mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd, IORING_OFF_SQES);
+	if ( cqRing == MAP_FAILED || sqes == MAP_FAILED ) {
+		teardown();
+		return false;
+	}
+
+	sqHead = (unsigned *)((char *)sqRing + p.sq_off.head);
+	sqTail = (unsigned *)((char *)sqRing + p.sq_off.tail);
+	sqMask = *(unsigned *)((char *)sqRing + p.sq_off.ring_mask);
+	sqArray = (unsigned *)((char *)sqRing + p.sq_off.array);
+	cqHead = (unsigned *)((char *)cqRing + p.cq_off.head);
+	cqTail = (unsigned *)((char *)cqRing + p.cq_off.tail);
+	cqMask = *(unsigned *)((char *)cqRing + p.cq_off.ring_mask);
+	cqes = (struct io_uring_cqe *)((char *)cqRing + p.cq_off.cqes);
+
+	bufBase = (char *) mmap(NULL, (size_t)URING_BUFS * URING_BUF_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	if ( bufBase == MAP_FAILED ) {
+		teardown();
+		return false;
+	}
+
+	provide(0, URING_BUFS);
+	if ( submit(1) < 0 || __atomic_load_n(cqTail, __ATOMIC_ACQUIRE) == *cqHead || cqes[*cqHead & cqMask].res < 0 ) {
+		teardown();
+		return false;
+	}
+	__atomic_store_n(cqHead, *cqHead + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: teardown
+ *
+ * DESCRIPTION: Close the ring and unmap whatever setup mapped
+ */
+void UringNet::teardown() {
+	if ( ringfd >= 0 ) {
+		close(ringfd);
+		ringfd = -1;
+	}
+	if ( sqes != MAP_FAILED ) {
+		munmap(sqes, sqesSize);
+		sqes = (struct io_uring_sqe *)MAP_FAILED;
+	}
+	if ( cqRing != MAP_FAILED && cqRing != sqRing ) {
+		munmap(cqRing, cqRingSize);
+	}
+	cqRing = MAP_FAILED;
+	if ( sqRing != MAP_FAILED ) {
+		munmap(sqRing, sqRingSize);
+		sqRing = MAP_FAILED;
+	}
+	if ( bufBase != MAP_FAILED ) {
+		munmap(bufBase, (size_t)URING_BUFS * URING_BUF_SIZE);
+		bufBase = (char *)MAP_FAILED;
+	}
+	uring = false;
+}
+
+/**
+ * FUNCTION NAME: getSqe
+ *
+ * DESCRIPTION: Claim the next submission queue entry, cleared. A full queue is submitted first.
+ */
+struct io_uring_sqe *UringNet::getSqe() {
+	if ( sqQueued == URING_ENTRIES ) {
+		submit(0);
+	}
+
+	unsigned tail = *sqTail;
+	unsigned idx = tail & sqMask;
+	struct io_uring_sqe *sqe = &sqes[idx];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqArray[idx] = idx;
+	__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+	sqQueued++;
+	return sqe;
+}
+
+/**
+ * FUNCTION NAME: submit
+ *
+ * DESCRIPTION: Submit the queued entries and, if wait > 0, block until that many completions are posted
+ *
+ * RETURNS:
+ * io_uring_enter's result
+ */
+int UringNet::submit(int wait) {
+	int n = sqQueued;
+	sqQueued = 0;
+	syscalls++;
+	return (int) syscall(__NR_io_uring_enter, ringfd, n, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+
+/**
+ * FUNCTION NAME: armRecv
+ *
+ * DESCRIPTION: Queue a multishot receive on this node's socket, taking buffers from the ring
+ */
+void UringNet::armRecv(int id) {
+	struct io_uring_sqe *sqe = getSqe();
+
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = nodes[id].fd;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_BGID;
+	sqe->user_data = id;
+}
+
+/**
+ * FUNCTION NAME: provide
+ *
+ * DESCRIPTION: Queue a request handing count consecutive receive buffers, from bid on, to the kernel
+ */
+void UringNet::provide(int bid, int count) {
+	struct io_uring_sqe *sqe = getSqe();
+
+	sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+	sqe->fd = count;
+	sqe->addr = (unsigned long)(bufBase + (size_t)bid * URING_BUF_SIZE);
+	sqe->len = URING_BUF_SIZE;
+	sqe->off = bid;
+	sqe->buf_group = URING_BGID;
+	sqe->user_data = URING_PROVIDE_TAG;
+}
+
+/**
+ * FUNCTION NAME: isRingBuf
+ *
+ * DESCRIPTION: Whether this buffer is one of the registered receive buffers
+ */
+bool UringNet::isRingBuf(char *data) {
+	return bufBase != MAP_FAILED && data >= bufBase && data < bufBase + (size_t)URING_BUFS * URING_BUF_SIZE;
+}
+
+/**
+ * FUNCTION NAME: reap
+ *
+ * DESCRIPTION: Consume every posted completion. Received datagrams are filed under their
+ * 				node; a receive that stopped is noted for rearming.
+ */
+void UringNet::reap() {
+	unsigned head = *cqHead;
+	unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+	int time = par->getcurrtime();
+
+	for ( ; head != tail; head++ ) {
+		struct io_uring_cqe *cqe = &cqes[head & cqMask];
+		cqeCount++;
+
+		if ( cqe->user_data & URING_SEND_TAG ) {
+			int id = (int)(cqe->user_data & ~URING_SEND_TAG);
+			sendsInFlight--;
+			if ( cqe->res < 0 ) {
+				// the socket buffer is full; a real network would lose these too
+				sendErrors++;
+			}
+			else {
+				getMsgCount(id).countSent(time, par->MSGCOUNT_WINDOW, cqe->res);
+			}
+			continue;
+		}
+		if ( cqe->user_data == URING_PROVIDE_TAG ) {
+			continue;
+		}
+
+		int id = (int)cqe->user_data;
+		if ( cqe->flags & IORING_CQE_F_BUFFER ) {
+			int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+			if ( cqe->res > 0 && (int)ready[id].size() < URING_BACKLOG ) {
+				UringRecv r;
+				r.data = bufBase + (size_t)bid * URING_BUF_SIZE;
+				r.size = cqe->res;
+				ready[id].push_back(r);
+			}
+			else {
+				// a node that does not receive loses what overflows, as its socket would
+				if ( cqe->res > 0 ) {
+					backlogDrops++;
+				}
+				provide(bid, 1);
+			}
+		}
+		else if ( cqe->res == -ENOBUFS ) {
+			bufExhausted++;
+		}
+		else if ( cqe->res < 0 && !(cqe->flags & IORING_CQE_F_MORE) ) {
+			// the kernel cannot do multishot receive on this socket
+			uring = false;
+		}
+
+		if ( !(cqe->flags & IORING_CQE_F_MORE) && uring ) {
+			rearm.push_back(id);
+		}
+	}
+
+	__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+}
+
+/**
+ * FUNCTION NAME: ENinit
+ *
+ * DESCRIPTION: Open the node's socket as UdpNet does and arm a receive on it
+ */
+void *UringNet::ENinit(Address *myaddr, short port) {
+	UdpNet::ENinit(myaddr, port);
+
+	int id = NodeId(*myaddr).getid();
+	if ( id >= (int)ready.size() ) {
+		ready.resize(id + 1);
+	}
+	if ( uring && nodes[id].fd >= 0 ) {
+		armRecv(id);
+		submit(0);
+	}
+	return myaddr;
+}
+
+/**
+ * FUNCTION NAME: ENcommit
+ *
+ * DESCRIPTION: Send this node's queued messages, URING_ENTRIES per io_uring_enter. The
+ * 				buffers go back to the pool once the kernel has completed every send.
+ *
+ * RETURNS:
+ * number of messages submitted
+ */
+int UringNet::ENcommit(Address *myaddr) {
+	if ( !uring ) {
+		return UdpNet::ENcommit(myaddr);
+	}
+
+	UdpNode *node = getNode(myaddr);
+	int id = NodeId(*myaddr).getid();
+	int total = (int)node->pending.size();
+	int submitted = 0;
+
+	if ( total == 0 ) {
+		return 0;
+	}
+	sendHdrs.resize(total);
+	sendIov.resize(total);
+	sendAddrs.resize(total);
+
+	for ( int i = 0; i < total; i++ ) {
+		en_msg &em = node->pending[i];
+		if ( dropOnSend(em) ) {
+			continue;
+		}
+		toSockaddr(&em.to, &sendAddrs[i]);
+		sendIov[i].iov_base = em.data;
+		sendIov[i].iov_len = em.size;
+		memset(&sendHdrs[i], 0, sizeof(struct msghdr));
+		sendHdrs[i].msg_name = &sendAddrs[i];
+		sendHdrs[i].msg_namelen = sizeof(struct sockaddr_in);
+		sendHdrs[i].msg_iov = &sendIov[i];
+		sendHdrs[i].msg_iovlen = 1;
+
+		struct io_uring_sqe *sqe = getSqe();
+		sqe->opcode = IORING_OP_SENDMSG;
+		sqe->fd = node->fd;
+		sqe->addr = (unsigned long) &sendHdrs[i];
+		sqe->len = 1;
+		sqe->msg_flags = MSG_DONTWAIT;
+		sqe->user_data = URING_SEND_TAG | id;
+		sendsInFlight++;
+		submitted++;
+	}
+	submit(0);
+
+	// receive completions may be posted in between, so count sends rather than completions
+	reap();
+	while ( sendsInFlight > 0 ) {
+		submit(1);
+		reap();
+	}
+
+	for ( int i = 0; i < total; i++ ) {
+		UdpNet::ENrelease(node->pending[i].data);
+	}
+	node->pending.clear();
+	return submitted;
+}
+
+/**
+ * FUNCTION NAME: ENdeliver
+ *
+ * DESCRIPTION: Once per tick: return released buffers to the kernel, collect the completions
+ * 				and rearm the receives that stopped, all in one system call.
+ */
+void UringNet::ENdeliver() {
+	if ( !uring ) {
+		UdpNet::ENdeliver();
+		return;
+	}
+	if ( lastReapTick == par->getcurrtime() ) {
+		return;
+	}
+	lastReapTick = par->getcurrtime();
+
+	// runs of consecutive buffers go back in a single request
+	vector<int> &all = freed[0];
+	for ( size_t s = 1; s < freed.size(); s++ ) {
+		all.insert(all.end(), freed[s].begin(), freed[s].end());
+		freed[s].clear();
+	}
+	sort(all.begin(), all.end());
+	for ( size_t j = 0; j < all.size(); ) {
+		size_t k = j + 1;
+		while ( k < all.size() && all[k] == all[k - 1] + 1 ) {
+			k++;
+		}
+		provide(all[j], (int)(k - j));
+		j = k;
+	}
+	all.clear();
+
+	reap();
+
+	for ( size_t j = 0; j < rearm.size() && uring; j++ ) {
+		armRecv(rearm[j]);
+	}
+	rearm.clear();
+	if ( sqQueued > 0 ) {
+		submit(0);
+	}
+}
+
+/**
+ * FUNCTION NAME: ENrecv
+ *
+ * DESCRIPTION: Hand the node the datagrams collected for it, in the buffers the kernel
+ * 				wrote them to. The receiver releases each with ENrelease.
+ *
+ * RETURN:
+ * 0
+ */
+int UringNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue) {
+	int id = NodeId(*myaddr).getid();
+	int time = par->getcurrtime();
+
+	ENdeliver();
+
+	vector<UringRecv> &r = ready[id];
+	for ( size_t i = 0; i < r.size(); i++ ) {
+		(*enq)(queue, r[i].data, r[i].size);
+		getMsgCount(id).countRecv(time, par->MSGCOUNT_WINDOW, r[i].size);
+	}
+	r.clear();
+
+	if ( !uring ) {
+		return UdpNet::ENrecv(myaddr, enq, t, times, queue);
+	}
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: ENrelease
+ *
+ * DESCRIPTION: Return a buffer handed out by ENrecv. Receive buffers wait in the calling
+ * 				thread's list until the next ENdeliver gives them back to the kernel.
+ */
+void UringNet::ENrelease(char *data) {
+	if ( isRingBuf(data) ) {
+		freed[uringShard].push_back((int)((data - bufBase) / URING_BUF_SIZE));
+	}
+	else {
+		UdpNet::ENrelease(data);
+	}
+}
+
+/**
+ * FUNCTION NAME: ENbind
+ *
+ * DESCRIPTION: Make the calling thread use message pool shard and freed-buffer list shard
+ */
+void UringNet::ENbind(int shard) {
+	UdpNet::ENbind(shard);
+	uringShard = shard % (int)freed.size();
+}
+
+/**
+ * FUNCTION NAME: ENcleanup
+ *
+ * DESCRIPTION: Write msgcount.log as UdpNet does, followed by the ring's own counters
+ */
+int UringNet::ENcleanup() {
+	UdpNet::ENcleanup();
+
+	FILE* file = fopen("msgcount.log", "a");
+	fprintf(file, "uring %s  cqes %ld  buffers_exhausted %ld  backlog_drops %ld\n", (bufBase != MAP_FAILED) ? "on" : "off", cqeCount, bufExhausted, backlogDrops);
+	fclose(file);
+	return 0;
+}
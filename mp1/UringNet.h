@@ -0,0 +1,126 @@
+/**********************************
+ * FILE NAME: UringNet.h
+ *
+ * DESCRIPTION: io_uring network classes header file
+ **********************************/
+
+#ifndef URINGNET_H_
+#define URINGNET_H_
+
+#include "stdincludes.h"
+#include "UdpNet.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/*
+ * Macros
+ */
+// submission queue entries; sends are submitted at most this many at a time
+#define URING_ENTRIES 256
+// receive buffers registered with the kernel, a power of two
+#define URING_BUFS 2048
+// size of one receive buffer, at least MAX_MSG_SIZE
+#define URING_BUF_SIZE 4096
+// buffer group the receive buffers are provided under
+#define URING_BGID 0
+// datagrams held for a node between two of its ENrecv calls, like a socket's receive queue
+#define URING_BACKLOG 256
+// set in the user_data of send completions, next to the node id; receives carry the bare id
+#define URING_SEND_TAG (1ULL << 32)
+// user_data of the requests that hand buffers back to the kernel
+#define URING_PROVIDE_TAG (1ULL << 33)
+
+/**
+ * STRUCT NAME: UringRecv
+ *
+ * DESCRIPTION: A datagram the kernel placed in one of the registered buffers
+ */
+typedef struct UringRecv {
+	char *data;
+	int size;
+}UringRecv;
+
+/**
+ * CLASS NAME: UringNet
+ *
+ * DESCRIPTION: UdpNet with the datagrams moved through io_uring. Sockets, addressing,
+ * 				drops and accounting are UdpNet's.
+ *
+ * 				Every local socket has one multishot receive armed on it that picks its
+ * 				buffers from a group of URING_BUFS buffers provided to the kernel up front.
+ * 				The completion queue lives in shared memory, so a tick's worth of datagrams
+ * 				is collected without a system call; ENrecv hands them to the node in place
+ * 				and ENrelease gives the buffers back to the kernel, coalesced into a few
+ * 				requests once per tick. A node's sends go out as one io_uring_enter per
+ * 				URING_ENTRIES messages.
+ *
+ * 				Buffers are provided with IORING_OP_PROVIDE_BUFFERS rather than a mapped
+ * 				buffer ring: on some kernels the ring registers but is never consumed.
+ * 				If the kernel lacks io_uring or multishot receive, everything falls back to
+ * 				UdpNet's sendmmsg/recvmmsg path.
+ */
+class UringNet : public UdpNet
+{
+private:
+	bool uring;
+	int ringfd;
+	// submission queue
+	void *sqRing;
+	size_t sqRingSize;
+	unsigned *sqHead;
+	unsigned *sqTail;
+	unsigned sqMask;
+	unsigned *sqArray;
+	struct io_uring_sqe *sqes;
+	size_t sqesSize;
+	// entries filled in but not submitted yet
+	int sqQueued;
+	// completion queue
+	void *cqRing;
+	size_t cqRingSize;
+	unsigned *cqHead;
+	unsigned *cqTail;
+	unsigned cqMask;
+	struct io_uring_cqe *cqes;
+	// receive buffers provided to the kernel
+	char *bufBase;
+	// buffers released per thread since the last tick, handed back in ENdeliver
+	vector< vector<int> > freed;
+	// datagrams received per node, not yet given to it
+	vector< vector<UringRecv> > ready;
+	// nodes whose multishot receive has ended and must be armed again
+	vector<int> rearm;
+	int lastReapTick;
+	long cqeCount;
+	long bufExhausted;
+	long backlogDrops;
+	// sends submitted whose completion has not been reaped yet
+	int sendsInFlight;
+	// headers of the sends in flight, reused by every ENcommit
+	vector<struct msghdr> sendHdrs;
+	vector<struct iovec> sendIov;
+	vector<struct sockaddr_in> sendAddrs;
+	UringNet(const UringNet &anotherUringNet);
+	UringNet& operator =(const UringNet &anotherUringNet);
+	bool setup();
+	void teardown();
+	struct io_uring_sqe *getSqe();
+	int submit(int wait);
+	void armRecv(int id);
+	void provide(int bid, int count);
+	void reap();
+	bool isRingBuf(char *data);
+public:
+	UringNet(Params *p);
+	virtual ~UringNet();
+	void *ENinit(Address *myaddr, short port);
+	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
+	void ENrelease(char *data);
+	int ENcommit(Address *myaddr);
+	void ENbind(int shard);
+	void ENdeliver();
+	int ENcleanup();
+};
+
+#endif /* URINGNET_H_ */
@@ -0,0 +1,51 @@
+/**********************************
+ * FILE NAME: Varint.h
+ *
+ * DESCRIPTION: LEB128 variable-length integers, as used by the compact membership list
+ **********************************/
+
+#ifndef VARINT_H_
+#define VARINT_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// longest encoding of a 64-bit value
+#define VARINT_MAX_LEN 10
+
+// Map signed values to unsigned ones with small magnitudes first: 0, -1, 1, -2, ...
+inline uint64_t zigzagEncode(int64_t v) {
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+inline int64_t zigzagDecode(uint64_t v) {
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Write v 7 bits at a time, low bits first; returns the position after it
+inline char *putVarint(char *out, uint64_t v) {
+	while ( v >= 0x80 ) {
+		*out++ = (char)(v | 0x80);
+		v >>= 7;
+	}
+	*out++ = (char)v;
+	return out;
+}
+
+// Read a value written by putVarint from [in, end); NULL if it runs past end or is too long
+inline const char *getVarint(const char *in, const char *end, uint64_t *v) {
+	uint64_t result = 0;
+	for ( int shift = 0; shift < 7 * VARINT_MAX_LEN && in < end; shift += 7 ) {
+		unsigned char byte = (unsigned char)*in++;
+		result |= (uint64_t)(byte & 0x7f) << shift;
+		if ( !(byte & 0x80) ) {
+			*v = result;
+			return in;
+		}
+	}
+	return NULL;
+}
+
+#endif /* VARINT_H_ */
@@ -0,0 +1,291 @@
+/**********************************
+ * FILE NAME: Wire.h
+ *
+ * DESCRIPTION: Layouts of the messages MP1Node sends, and views that read and write their
+ * 				fields in place in the message buffer
+ **********************************/
+
+#ifndef WIRE_H_
+#define WIRE_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+#include "Varint.h"
+
+/*
+ * Macros
+ */
+// an address on the wire: the id, then the port, as in Address
+#define WIRE_ADDR_LEN 6
+
+/**
+ * STRUCT NAME: WireCodec
+ *
+ * DESCRIPTION: How a field type sits on the wire: its size, and loading and storing it
+ * 				at a position that need not be aligned. Integers go in host order, as
+ * 				Address always has.
+ */
+template <typename T>
+struct WireCodec {
+	static constexpr int SIZE = sizeof(T);
+	static T load(const char *p) {
+		T v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+	static void store(char *p, T v) {
+		memcpy(p, &v, sizeof(v));
+	}
+};
+
+template <>
+struct WireCodec<NodeId> {
+	static constexpr int SIZE = WIRE_ADDR_LEN;
+	static NodeId load(const char *p) {
+		uint32_t id;
+		uint16_t port;
+		memcpy(&id, p, sizeof(id));
+		memcpy(&port, p + sizeof(id), sizeof(port));
+		return NodeId((int)id, (short)port);
+	}
+	static void store(char *p, NodeId v) {
+		uint32_t id = (uint32_t)v.getid();
+		uint16_t port = (uint16_t)v.getport();
+		memcpy(p, &id, sizeof(id));
+		memcpy(p + sizeof(id), &port, sizeof(port));
+	}
+};
+
+/**
+ * STRUCT NAME: WireField
+ *
+ * DESCRIPTION: A fixed field of a layout: its type and where it starts and ends
+ */
+template <typename T, int Offset>
+struct WireField {
+	typedef T type;
+	static constexpr int OFFSET = Offset;
+	static constexpr int END = Offset + WireCodec<T>::SIZE;
+};
+
+/*
+ * Layouts of the fixed part of each message, after the MessageHdr. SIZE is where the
+ * variable part, if any, begins.
+ */
+
+// JOINREQ
+struct JoinReqWire {
+	typedef WireField<NodeId, 0> From;
+	typedef WireField<int64_t, From::END> Heartbeat;
+	static constexpr int SIZE = Heartbeat::END;
+};
+
+// JOINREP and HEARTBEATREQ, followed by a membership list, and HEARTBEATREP. A
+// HEARTBEATREQ or HEARTBEATREP may then carry rumors.
+struct FromWire {
+	typedef WireField<NodeId, 0> From;
+	static constexpr int SIZE = From::END;
+};
+
+// PING, PING_REQ and ACK, followed by piggybacked updates. A PING_REQ asks From to probe
+// Target for Origin; an ACK travels back to Origin, through whoever probed on its behalf.
+struct SwimWire {
+	typedef WireField<NodeId, 0> From;
+	typedef WireField<NodeId, From::END> Origin;
+	typedef WireField<NodeId, Origin::END> Target;
+	// probe number at Origin
+	typedef WireField<uint32_t, Target::END> Seq;
+	static constexpr int SIZE = Seq::END;
+};
+
+// The HyParView messages, followed by Count addresses
+struct HvWire {
+	typedef WireField<NodeId, 0> From;
+	// FORWARD_JOIN: the joining node; SHUFFLE: the node that started the walk
+	typedef WireField<NodeId, From::END> Node;
+	// hops left on a random walk
+	typedef WireField<uint8_t, Node::END> Ttl;
+	// NEIGHBOR: the request must be accepted; NEIGHBOR_REP: it was
+	typedef WireField<uint8_t, Ttl::END> Flag;
+	typedef WireField<uint8_t, Flag::END> Count;
+	static constexpr int SIZE = Count::END;
+};
+
+// DIGEST
+struct DigestWire {
+	typedef WireField<NodeId, 0> From;
+	typedef WireField<uint64_t, From::END> Root;
+	static constexpr int SIZE = Root::END;
+};
+
+// DIGEST_REP, followed by the hash of each bucket set in Mask
+struct DigestRepWire {
+	typedef WireField<NodeId, 0> From;
+	typedef WireField<uint64_t, From::END> Mask;
+	static constexpr int SIZE = Mask::END;
+};
+
+// DIGEST_SYNC, followed by a membership list
+struct DigestSyncWire {
+	typedef WireField<NodeId, 0> From;
+	typedef WireField<uint64_t, From::END> Buckets;
+	// the receiver should answer with its own members in Buckets
+	typedef WireField<uint8_t, Buckets::END> Reply;
+	static constexpr int SIZE = Reply::END;
+};
+
+/**
+ * CLASS NAME: WireReader
+ *
+ * DESCRIPTION: Cursor over the variable part of a received message. A read that would run
+ * 				past the end returns zero and fails the reader for good, so a parser can
+ * 				read everything and check ok() once.
+ */
+class WireReader {
+private:
+	const char *in;
+	const char *end;
+	bool good;
+public:
+	WireReader(const char *in, int size): in(in), end(in + (size > 0 ? size : 0)), good(true) {}
+	bool ok() const {
+		return good;
+	}
+	// Nothing left to read
+	bool empty() const {
+		return in >= end;
+	}
+	// Bytes left to read
+	int left() const {
+		return (int)(end - in);
+	}
+	// The next n bytes, in place, or NULL
+	const char *take(int n) {
+		if ( !good || n < 0 || end - in < n ) {
+			good = false;
+			return NULL;
+		}
+		const char *p = in;
+		in += n;
+		return p;
+	}
+	template <typename T>
+	T get() {
+		const char *p = take(WireCodec<T>::SIZE);
+		return p ? WireCodec<T>::load(p) : T();
+	}
+	uint64_t varint() {
+		uint64_t v = 0;
+		const char *next = good ? getVarint(in, end, &v) : NULL;
+		if ( !next ) {
+			good = false;
+			return 0;
+		}
+		in = next;
+		return v;
+	}
+};
+
+/**
+ * CLASS NAME: WireWriter
+ *
+ * DESCRIPTION: Cursor writing the variable part of a message into its send buffer. Buffers
+ * 				are sized from the largest message that can be built, so running out of
+ * 				room is a bug; the writer stops and ok() says so.
+ */
+class WireWriter {
+private:
+	char *start;
+	char *out;
+	char *end;
+	bool good;
+public:
+	WireWriter(char *out, int capacity): start(out), out(out), end(out + capacity), good(true) {}
+	bool ok() const {
+		return good;
+	}
+	// Bytes written so far
+	int size() const {
+		return (int)(out - start);
+	}
+	// Room for n bytes the caller fills in itself, or NULL
+	char *reserve(int n) {
+		if ( !good || end - out < n ) {
+			good = false;
+			return NULL;
+		}
+		char *p = out;
+		out += n;
+		return p;
+	}
+	template <typename T>
+	void put(T v) {
+		char *p = reserve(WireCodec<T>::SIZE);
+		if ( p ) {
+			WireCodec<T>::store(p, v);
+		}
+	}
+	void varint(uint64_t v) {
+		if ( !good || end - out < VARINT_MAX_LEN ) {
+			good = false;
+			return;
+		}
+		out = putVarint(out, v);
+	}
+};
+
+/**
+ * CLASS NAME: WireView
+ *
+ * DESCRIPTION: A received message body read through its Layout. Fields are loaded straight
+ * 				from the buffer at offsets fixed at compile time; valid() must be checked
+ * 				before any of them is read.
+ */
+template <class Layout>
+class WireView {
+private:
+	const char *data;
+	int size;
+public:
+	WireView(const char *data, int size): data(data), size(size) {}
+	bool valid() const {
+		return size >= Layout::SIZE;
+	}
+	template <class Field>
+	typename Field::type get() const {
+		static_assert(Field::END <= Layout::SIZE, "field lies outside the layout");
+		return WireCodec<typename Field::type>::load(data + Field::OFFSET);
+	}
+	// The variable part
+	WireReader rest() const {
+		return WireReader(data + Layout::SIZE, size - Layout::SIZE);
+	}
+};
+
+/**
+ * CLASS NAME: WireBuilder
+ *
+ * DESCRIPTION: A message body being written through its Layout, straight into the buffer
+ * 				it will be sent from
+ */
+template <class Layout>
+class WireBuilder {
+private:
+	char *data;
+	int capacity;
+public:
+	WireBuilder(char *data, int capacity): data(data), capacity(capacity) {
+		assert(capacity >= Layout::SIZE);
+	}
+	template <class Field>
+	void set(typename Field::type v) {
+		static_assert(Field::END <= Layout::SIZE, "field lies outside the layout");
+		WireCodec<typename Field::type>::store(data + Field::OFFSET, v);
+	}
+	// The variable part
+	WireWriter rest() {
+		return WireWriter(data + Layout::SIZE, capacity - Layout::SIZE);
+	}
+};
+
+#endif /* WIRE_H_ */
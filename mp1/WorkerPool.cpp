@@ -0,0 +1,112 @@
+/**********************************
+ * FILE NAME: WorkerPool.cpp
+ *
+ * DESCRIPTION: Definition of the WorkerPool class
+ **********************************/
+
+#include "WorkerPool.h"
+
+/**
+ * Constructor
+ */
+WorkerPool::WorkerPool(int nthreads): nthreads(nthreads), generation(0), running(0), stopping(false) {
+	ranges = new Range[nthreads];
+	for ( int i = 0; i < nthreads; i++ ) {
+		ranges[i].next = 0;
+		ranges[i].end = 0;
+	}
+	for ( int i = 1; i < nthreads; i++ ) {
+		threads.push_back(thread(&WorkerPool::workerMain, this, i));
+	}
+}
+
+/**
+ * Destructor
+ */
+WorkerPool::~WorkerPool() {
+	{
+		unique_lock<mutex> lock(mtx);
+		stopping = true;
+	}
+	start.notify_all();
+	for ( size_t i = 0; i < threads.size(); i++ ) {
+		threads[i].join();
+	}
+	delete[] ranges;
+}
+
+/**
+ * FUNCTION NAME: run
+ *
+ * DESCRIPTION: Call fn(item, worker) for every item in [0, items) and wait for all of them
+ */
+void WorkerPool::run(int items, function<void(int item, int worker)> fn) {
+	for ( int i = 0; i < nthreads; i++ ) {
+		ranges[i].next = (int)((long)items * i / nthreads);
+		ranges[i].end = (int)((long)items * (i + 1) / nthreads);
+	}
+
+	{
+		unique_lock<mutex> lock(mtx);
+		job = fn;
+		running = nthreads - 1;
+		generation++;
+	}
+	start.notify_all();
+
+	work(0);
+
+	unique_lock<mutex> lock(mtx);
+	while ( running > 0 ) {
+		done.wait(lock);
+	}
+}
+
+/**
+ * FUNCTION NAME: work
+ *
+ * DESCRIPTION: Drain this worker's own range, then help the others with theirs
+ */
+void WorkerPool::work(int worker) {
+	for ( int k = 0; k < nthreads; k++ ) {
+		Range &range = ranges[(worker + k) % nthreads];
+		while ( true ) {
+			int first = range.next.fetch_add(WORKER_CHUNK);
+			if ( first >= range.end ) {
+				break;
+			}
+			int last = min(first + WORKER_CHUNK, range.end);
+			for ( int i = first; i < last; i++ ) {
+				job(i, worker);
+			}
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: workerMain
+ *
+ * DESCRIPTION: Body of every thread but the caller's: wait for a loop, take part, report back
+ */
+void WorkerPool::workerMain(int worker) {
+	int seen = 0;
+	while ( true ) {
+		{
+			unique_lock<mutex> lock(mtx);
+			while ( generation == seen && !stopping ) {
+				start.wait(lock);
+			}
+			if ( stopping ) {
+				return;
+			}
+			seen = generation;
+		}
+
+		work(worker);
+
+		unique_lock<mutex> lock(mtx);
+		if ( --running == 0 ) {
+			done.notify_one();
+		}
+	}
+}
@@ -0,0 +1,63 @@
+/**********************************
+ * FILE NAME: WorkerPool.h
+ *
+ * DESCRIPTION: Header file of the WorkerPool class
+ **********************************/
+
+#ifndef WORKERPOOL_H_
+#define WORKERPOOL_H_
+
+#include "stdincludes.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+/*
+ * Macros
+ */
+// items a worker claims at a time, from its own range or a victim's
+#define WORKER_CHUNK 16
+
+/**
+ * CLASS NAME: WorkerPool
+ *
+ * DESCRIPTION: Persistent worker threads that run one indexed loop at a time. Each
+ * 				worker starts on its own contiguous share of the items and, once that is
+ * 				used up, steals chunks from the shares of the others. run() only returns
+ * 				after every item is done, so consecutive calls are separated by a barrier.
+ * 				The calling thread takes part as worker 0.
+ */
+class WorkerPool {
+private:
+	struct Range {
+		atomic<int> next;
+		int end;
+		// keep each cursor on its own cache line
+		char pad[64 - sizeof(atomic<int>) - sizeof(int)];
+	};
+	int nthreads;
+	vector<thread> threads;
+	Range *ranges;
+	mutex mtx;
+	condition_variable start;
+	condition_variable done;
+	int generation;
+	int running;
+	bool stopping;
+	function<void(int, int)> job;
+	WorkerPool(const WorkerPool &anotherPool);
+	WorkerPool& operator =(const WorkerPool &anotherPool);
+	void work(int worker);
+	void workerMain(int worker);
+public:
+	WorkerPool(int nthreads);
+	virtual ~WorkerPool();
+	int size() {
+		return nthreads;
+	}
+	void run(int items, function<void(int item, int worker)> fn);
+};
+
+#endif /* WORKERPOOL_H_ */
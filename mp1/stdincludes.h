@@ -22,6 +22,8 @@
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <limits.h>
+#include <stdint.h>
 #include <time.h>
 #include <stdarg.h>
 #include <unistd.h>